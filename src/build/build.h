@@ -58,6 +58,7 @@ static void build_build(Build *app, Cli *cli) {
     bool watch = cli_flag(cli, "--watch", "Build an executable and watch changes");
     bool release = cli_flag(cli, "--release", "Compile in Release Mode");
     bool dynamic = cli_flag(cli, "--dynamic", "Create a dynamic library");
+    bool guard = cli_flag(cli, "--guard", "Place every allocation before a guard page");
     bool lsp = cli_flag(cli, "--lsp", "Generate a compile_commands.json");
 
     bool plat_linux = cli_flag(cli, "--linux", "Compile for Linux");
@@ -72,6 +73,7 @@ static void build_build(Build *app, Cli *cli) {
     opts.output_path = output;
     opts.release = release;
     opts.dynamic = dynamic;
+    opts.guard = guard;
     opts.platform = Platform_Linux;
     if (plat_linux) opts.platform = Platform_Linux;
     if (plat_windows) opts.platform = Platform_Windows;
@@ -17,6 +17,9 @@ struct Clang_Options {
     Platform platform;
     bool release;
     bool dynamic;
+
+    // Debug memory allocator, place every allocation before a guard page (see MEM_GUARD in mem.h)
+    bool guard;
 };
 
 static char *platform_to_string(Platform p) {
@@ -62,6 +65,9 @@ static void clang_fmt(Fmt *fmt, Clang_Options opt) {
         // Compiling to windows from linux
         fmt_s(fmt, " -target x86_64-unknown-windows-gnu");
 #endif
+
+        // WaitOnAddress, used by "lib/mutex.h"
+        fmt_s(fmt, " -lsynchronization");
     }
 
     // Webassembly
@@ -82,6 +88,9 @@ static void clang_fmt(Fmt *fmt, Clang_Options opt) {
         fmt_s(fmt, " -O0 -g");
     }
 
+    // Guard page allocator
+    if (opt.guard) fmt_s(fmt, " -DMEM_GUARD=1");
+
     // Create a '.so' file for dynamic loading
     if (opt.dynamic) fmt_s(fmt, " -shared");
 
@@ -104,6 +113,7 @@ static bool clang_compile(Clang_Options opt) {
     fmt_s(G->fmt, " in");
     if (opt.dynamic) fmt_s(G->fmt, " Dynamic");
     fmt_s(G->fmt, opt.release ? " Release" : " Debug");
+    if (opt.guard) fmt_s(G->fmt, " Guard");
     fmt_s(G->fmt, " mode for ");
     fmt_s(G->fmt, platform_to_string(opt.platform));
     fmt_s(G->fmt, "\n");
@@ -22,13 +22,13 @@ struct Watch {
 };
 
 static bool watch_add(Watch *watch, char *path) {
-    Memory *mem = mem_new();
-    for (FS_Dir *dir = fs_list(mem, str_from(path)); dir; dir = dir->next) {
+    Memory_Mark mark = mem_mark(G->tmp);
+    for (FS_Dir *dir = fs_list(G->tmp, str_from(path)); dir; dir = dir->next) {
         if (!dir->is_dir) continue;
-        String path2 = str_cat3(mem, str_from(path), S("/"), dir->name);
+        String path2 = str_cat3(G->tmp, str_from(path), S("/"), dir->name);
         watch_add(watch, (char *)path2.data);
     }
-    mem_free(mem);
+    mem_rewind(G->tmp, mark);
 
     if (watch->count == 0) {
         watch->fd = linux_inotify_init(O_NONBLOCK);
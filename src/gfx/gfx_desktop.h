@@ -46,7 +46,12 @@ struct Gfx {
     // Texture
     GLuint texture;
 
+    // Memory for a single frame, rewound to 'tmp_mark' in gfx_end
     Memory *tmp;
+    Memory_Mark tmp_mark;
+
+    // Quads to draw this frame, the pool lives in 'tmp'
+    Pool pass_pool;
     Packer *pack;
     Gfx_Pass_List pass_3d;
     Gfx_Pass_List pass_ui;
@@ -65,6 +70,9 @@ static void sdl_audio_callback_wrapper(void *user, SDL_AudioStream *stream, int
 
 static Gfx *gfx_init(Memory *mem, const char *title) {
     Gfx *gfx = mem_struct(mem, Gfx);
+    gfx->tmp = mem_new();
+    mem_set_name(gfx->tmp, "gfx tmp");
+    gfx->tmp_mark = mem_mark(gfx->tmp);
 
     // SDL3 windowing
     File *lib_sdl = os_dlopen(OS_IS_LINUX ? S("libSDL3.so") : S("SDL3.dll"));
@@ -183,7 +191,7 @@ static Gfx *gfx_init(Memory *mem, const char *title) {
 }
 
 static Input *gfx_begin(Gfx *gfx) {
-    gfx->tmp = mem_new();
+    gfx->pass_pool = pool_for(gfx->tmp, Gfx_Pass);
 
     // Update audio callback
     if (G->reloaded || !gfx->audio_callback) gfx->audio_callback = gfx_audio_callback;
@@ -264,11 +272,11 @@ static Input *gfx_begin(Gfx *gfx) {
 
 // Draw image during render
 static void gfx_draw_3d(Gfx *gfx, m4 mtx, Image *img) {
-    gfx_pass_push(gfx->tmp, &gfx->pass_3d, mtx, img);
+    gfx_pass_push(&gfx->pass_pool, &gfx->pass_3d, mtx, img);
 }
 
 static void gfx_draw_ui(Gfx *gfx, m4 mtx, Image *img) {
-    gfx_pass_push(gfx->tmp, &gfx->pass_ui, mtx, img);
+    gfx_pass_push(&gfx->pass_pool, &gfx->pass_ui, mtx, img);
 }
 
 static void gfx_draw_pass(Gfx *gfx, Gfx_Pass_List *pass) {
@@ -319,8 +327,7 @@ static void gfx_end(Gfx *gfx, v3 clear_color, m4 camera) {
     // Swap
     sdl->SDL_GL_SwapWindow(gfx->window);
 
-    mem_free(gfx->tmp);
-    gfx->tmp = 0;
+    mem_rewind(gfx->tmp, gfx->tmp_mark);
 }
 
 // Set mouse grab
@@ -3,6 +3,7 @@
 #pragma once
 #include "gfx/texture_packer.h"
 #include "lib/mat.h"
+#include "lib/pool.h"
 
 #define GFX_ATLAS_SIZE 4096
 
@@ -54,8 +55,8 @@ static Gfx_Quad gfx_help_make_quad(m4 mtx, v2u pos, v2u size) {
 }
 
 // Insert quad into render pass
-static void gfx_pass_push(Memory *mem, Gfx_Pass_List *pass_list, m4 mtx, Image *img) {
-    Gfx_Pass *pass = mem_struct(mem, Gfx_Pass);
+static void gfx_pass_push(Pool *pool, Gfx_Pass_List *pass_list, m4 mtx, Image *img) {
+    Gfx_Pass *pass = pool_struct(pool, Gfx_Pass);
     pass->mtx = mtx;
     pass->img = img;
     LIST_APPEND(pass_list->first, pass_list->last, pass);
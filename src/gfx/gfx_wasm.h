@@ -12,7 +12,12 @@ struct Gfx {
     Input next_input;
     v2 sample_buffer[1024];
 
+    // Memory for a single frame, rewound to 'tmp_mark' in gfx_end
     Memory *tmp;
+    Memory_Mark tmp_mark;
+
+    // Quads to draw this frame, the pool lives in 'tmp'
+    Pool pass_pool;
     Packer *pack;
     Gfx_Pass_List pass_3d;
     Gfx_Pass_List pass_ui;
@@ -24,6 +29,9 @@ struct Gfx GFX_GLOBAL;
 WASM_IMPORT(wasm_gfx_init) void wasm_gfx_init(void);
 static Gfx *gfx_init(Memory *mem, const char *title) {
     Gfx *gfx = &GFX_GLOBAL;
+    gfx->tmp = mem_new();
+    mem_set_name(gfx->tmp, "gfx tmp");
+    gfx->tmp_mark = mem_mark(gfx->tmp);
     wasm_gfx_init();
     return gfx;
 }
@@ -35,7 +43,7 @@ static Input *gfx_begin(Gfx *gfx) {
     input_reset(&gfx->next_input);
     wasm_gfx_begin_audio();
 
-    gfx->tmp = mem_new();
+    gfx->pass_pool = pool_for(gfx->tmp, Gfx_Pass);
     gfx->pass_3d = (Gfx_Pass_List){};
     gfx->pass_ui = (Gfx_Pass_List){};
     return &gfx->input;
@@ -74,16 +82,15 @@ static void gfx_end(Gfx *gfx, v3 clear_color, m4 camera) {
     m44 screen = m4_screen_to_clip(m4_id(), gfx->input.window_size);
     wasm_gfx_begin_ui(&screen);
     gfx_draw_pass(gfx, &gfx->pass_ui);
-    mem_free(gfx->tmp);
-    gfx->tmp = 0;
+    mem_rewind(gfx->tmp, gfx->tmp_mark);
 }
 
 static void gfx_draw_3d(Gfx *gfx, m4 mtx, Image *img) {
-    gfx_pass_push(gfx->tmp, &gfx->pass_3d, mtx, img);
+    gfx_pass_push(&gfx->pass_pool, &gfx->pass_3d, mtx, img);
 }
 
 static void gfx_draw_ui(Gfx *gfx, m4 mtx, Image *img) {
-    gfx_pass_push(gfx->tmp, &gfx->pass_ui, mtx, img);
+    gfx_pass_push(&gfx->pass_pool, &gfx->pass_ui, mtx, img);
 }
 
 WASM_IMPORT(wasm_gfx_set_grab) void wasm_gfx_set_grab(bool grab);
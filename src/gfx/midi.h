@@ -10,6 +10,7 @@
 // https://www.youtube.com/watch?v=P27ml4M3V7A
 
 typedef struct {
+    // Start and length in ticks, the start is relative to the start of the track
     u32 time;
     u32 duration;
     u8 note;
@@ -18,16 +19,28 @@ typedef struct {
     bool down;
 } Midi_Note;
 
+// Default tempo, 120 beats per minute
+#define MIDI_TEMPO 500000
+
 typedef struct Midi_Track Midi_Track;
 struct Midi_Track {
     Midi_Track *next;
+
+    // First tempo change in the track, in microseconds per quarter note. 0 if there is none.
+    u32 tempo;
+
+    // Sorted by start time
     u32 note_count;
     Midi_Note *notes;
 };
 
 typedef struct {
+    // Ticks per quarter note
     u16 divisions;
     u16 track_count;
+
+    // Microseconds per quarter note, tempo changes after the first are not supported
+    u32 tempo;
     Midi_Track *tracks;
 } Midi;
 
@@ -39,6 +52,7 @@ static Midi_Track *midi_read_track(Memory *mem, String *read) {
 
     Midi_Track *track = mem_struct(mem, Midi_Track);
     u8 status = 0;
+    u32 tick = 0;
 
     u32 note_cap = size / 3;
     u32 note_count = 0;
@@ -46,46 +60,40 @@ static Midi_Track *midi_read_track(Memory *mem, String *read) {
     for (;;) {
         if (data.len == 0) break;
         // MTrk  event
-        u32 dt = read_varint(&data);
+        tick += read_varint(&data);
 
-        // Midi event
+        // Midi event, channel messages can omit the status byte (running status)
         bool has_status = read_peek_u8(&data) >= 0x80;
-        if (has_status) status = read_u8(&data);
+        u8 event_status = has_status ? read_u8(&data) : status;
+        if (event_status < 0xf0) status = event_status;
 
-        u8 event = status >> 4;
-        u8 channel = status & 0xf;
+        u8 event = event_status >> 4;
+        u8 channel = event_status & 0xf;
 
-        if (status == 0xf0 || status == 0xf7) {
+        if (event_status == 0xf0 || event_status == 0xf7) {
             // Sysex event
             u32 len = read_varint(&data);
-            String data = read_buf(&data, len);
-        } else if (status == 0xff) {
+            read_buf(&data, len);
+        } else if (event_status == 0xff) {
             // Meta Event
             u8 type = read_u8(&data);
             u32 len = read_varint(&data);
-            String data = read_buf(&data, len);
-        } else if (event == 0x8) {
-            // Note off
+            String meta = read_buf(&data, len);
+
+            // Set tempo
+            if (type == 0x51 && meta.len == 3 && !track->tempo) {
+                track->tempo = meta.data[0] << 16 | meta.data[1] << 8 | meta.data[2];
+            }
+        } else if (event == 0x8 || event == 0x9) {
+            // Note off, or note on. A note on with a velocity of 0 is also a note off.
             u8 note = read_u8(&data);
             u8 vel = read_u8(&data);
             assert0(note_count < note_cap);
             note_list[note_count++] = (Midi_Note){
                 .note = note,
                 .vel = vel,
-                .down = false,
-                .time = dt,
-                .chan = channel,
-            };
-        } else if (event == 0x9) {
-            // Note on
-            u8 note = read_u8(&data);
-            u8 vel = read_u8(&data);
-            assert0(note_count < note_cap);
-            note_list[note_count++] = (Midi_Note){
-                .note = note,
-                .vel = vel,
-                .down = true,
-                .time = dt,
+                .down = event == 0x9 && vel > 0,
+                .time = tick,
                 .chan = channel,
             };
         } else if (event == 0xa) {
@@ -107,40 +115,30 @@ static Midi_Track *midi_read_track(Memory *mem, String *read) {
             u16 value = read_u16(&data);
         }
     }
-    track->note_count = note_count;
-    track->notes = note_list;
 
-    // Compute duration
+    // Compute duration, until the next note off of the same note
     for (u32 i = 0; i < note_count; ++i) {
         Midi_Note *note = note_list + i;
         if (!note->down) continue;
 
-        note->duration = 0;
-        for (u32 j = i; j < note_count; ++j) {
+        note->duration = tick - note->time;
+        for (u32 j = i + 1; j < note_count; ++j) {
             Midi_Note *other = note_list + j;
-            note->duration += other->time;
             if (other->down) continue;
             if (other->note != note->note) continue;
             if (other->chan != note->chan) continue;
+            note->duration = other->time - note->time;
             break;
         }
     }
 
     // Remove up events
     u32 j = 0;
-    u32 t = 0;
     for (u32 i = 0; i < note_count; ++i) {
-        Midi_Note *note = note_list + i;
-        if (note->down) {
-            note->time += t;
-            t = 0;
-            note_list[j++] = *note;
-        } else {
-            t += note->time;
-        }
+        if (note_list[i].down) note_list[j++] = note_list[i];
     }
     track->note_count = j;
-
+    track->notes = note_list;
     return track;
 }
 
@@ -166,18 +164,56 @@ static Midi *midi_read(Memory *mem, String *read) {
     Midi *midi = mem_struct(mem, Midi);
     midi->divisions = divisions;
     midi->track_count = track_count;
+    midi->tempo = MIDI_TEMPO;
 
+    // The tempo is usually set in the first track
+    bool has_tempo = false;
     Midi_Track *last = 0;
     for (u32 i = 0; i < track_count; ++i) {
         Midi_Track *track = midi_read_track(mem, read);
+        if (!track) return 0;
         LIST_APPEND(midi->tracks, last, track);
+
+        if (track->tempo && !has_tempo) {
+            midi->tempo = track->tempo;
+            has_tempo = true;
+        }
     }
     return midi;
 }
 
+// Single track with three notes, 96 ticks per quarter note at 120 BPM
+static String midi_test_file(void) {
+    static u8 data[] = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6, // Header
+        0, 0,                           // Format 0, single track
+        0, 1,                           // One track
+        0, 96,                          // 96 Ticks per quarter note
+        'M', 'T', 'r', 'k', 0, 0, 0, 34, // Track
+        0, 0xff, 0x51, 3, 0x07, 0xa1, 0x20, // t=0, Tempo 500000 us per quarter note
+        0, 0x90, 60, 100,                   // t=0, C4 on
+        96, 0x80, 60, 64,                   // t=96, C4 off
+        0, 0x90, 64, 100,                   // t=96, E4 on
+        48, 64, 0,                          // t=144, E4 off (running status, note on with velocity 0)
+        48, 67, 80,                         // t=192, G4 on (running status)
+        0x81, 0x40, 0x80, 67, 0,            // t=384, G4 off
+        0, 0xff, 0x2f, 0,                   // t=384, End of track
+    };
+    return (String){.len = sizeof(data), .data = data};
+}
+
 static void midi_test(Test *test) {
-    Memory *mem = test->mem;
-    String file = os_readfile(mem, S("test.mid"));
-    Midi *midi = midi_read(mem, &file);
-    assert(midi, "Failed to parse midi");
+    String file = midi_test_file();
+    Midi *midi = midi_read(test->mem, &file);
+    TEST(midi);
+    TEST(midi->divisions == 96);
+    TEST(midi->tempo == 500000);
+    TEST(midi->track_count == 1);
+
+    Midi_Track *track = midi->tracks;
+    TEST(track->note_count == 3);
+    TEST(track->notes[0].note == 60 && track->notes[0].time == 0 && track->notes[0].duration == 96);
+    TEST(track->notes[1].note == 64 && track->notes[1].time == 96 && track->notes[1].duration == 48);
+    TEST(track->notes[2].note == 67 && track->notes[2].time == 192 && track->notes[2].duration == 192);
+    TEST(track->notes[2].vel == 80);
 }
@@ -4,6 +4,9 @@
 #include "gfx/sound_effect.h"
 #include "gfx/sound_env.h"
 #include "gfx/sound_filter.h"
+#include "gfx/sound_freeverb.h"
 #include "gfx/sound_music.h"
 #include "gfx/sound_osc.h"
+#include "gfx/sound_sequencer.h"
 #include "gfx/sound_var.h"
+#include "gfx/sound_wavetable.h"
@@ -13,6 +13,10 @@ static f32 sound_adsr(Sound *sound, bool down, f32 attack, f32 decay, f32 sustai
     u32 *state = sound_var(sound, u32);
     if (*state > 2) *state = 0;
 
+    // Smoothing coefficients of the attack and the decay
+    f32 a_attack = sound_coef_exp(sound_var(sound, Sound_Coef), attack);
+    f32 a_decay = sound_coef_exp(sound_var(sound, Sound_Coef), decay);
+
     // Release -> Attack
     if (*state == 0 && down) *state = 1;
 
@@ -22,26 +26,82 @@ static f32 sound_adsr(Sound *sound, bool down, f32 attack, f32 decay, f32 sustai
     // Sustain -> Release
     if (*state == 2 && !down) *state = 0;
 
-    // Exponential target and speed
-    f32 speed = 0.0f;
+    // Exponential target
     f32 target = 0.0f;
     if (*state == 0) {
         // Release
-        speed = decay;
         target = 0.0f;
     } else if (*state == 1) {
         // Attack
-        speed = attack;
         target = 1.5f;
     } else if (*state == 2) {
         // Release
-        speed = decay;
         target = sustain;
     }
 
     // Actual value should be this:
-    float a = 1 - f_exp(-speed * SOUND_DT);
+    f32 a = *state == 1 ? a_attack : a_decay;
     *value += a * (target - *value);
     if (*value > 1.0f) *value = 1.0f;
     return *value;
 }
+
+// Same as sound_adsr, but 'down' is constant for the whole block.
+// Returns 'count', or 0 if the envelope is silent for the whole block.
+// Pass the result as the count of the rest of the voice, so a silent voice costs almost nothing.
+static u32 sound_adsr_block(Sound *sound, u32 count, f32 *out, bool down, f32 attack, f32 decay, f32 sustain) {
+    f32 *value = sound_var(sound, f32);
+    u32 *state = sound_var(sound, u32);
+    if (*state > 2) *state = 0;
+
+    // Smoothing coefficients of the attack and the decay
+    f32 a_attack = sound_coef_exp(sound_var(sound, Sound_Coef), attack);
+    f32 a_decay = sound_coef_exp(sound_var(sound, Sound_Coef), decay);
+
+    // Released and silent
+    if (*state == 0 && !down && *value < SOUND_SILENCE) {
+        *value = 0.0f;
+        sound_block_fill(count, out, 0.0f);
+        return 0;
+    }
+
+    f32 v = *value;
+    u32 s = *state;
+    u32 i = 0;
+
+    // Attack until the value reaches 1
+    for (; i < count; ++i) {
+        if (s == 0 && down) s = 1;
+        if (s == 1 && v >= 1.0f) s = 2;
+        if (s == 2 && !down) s = 0;
+        if (s != 1) break;
+
+        v += a_attack * (1.5f - v);
+        if (v > 1.0f) v = 1.0f;
+        out[i] = v;
+    }
+
+    // Sustain or release for the rest of the block.
+    // Moving towards the target is a geometric series: v[i] = target + (v[0] - target) * k^i.
+    // Computing it in chunks of 8 samples allows the loop to be vectorized.
+    if (i < count) {
+        f32 target = s == 2 ? sustain : 0.0f;
+        f32 k[8];
+        k[0] = 1 - a_decay;
+        for (u32 j = 1; j < 8; ++j) k[j] = k[j - 1] * k[0];
+
+        f32 d = v - target;
+        for (; i + 8 <= count; i += 8) {
+            for (u32 j = 0; j < 8; ++j) out[i + j] = target + d * k[j];
+            d *= k[7];
+        }
+        u32 rest = count - i;
+        for (u32 j = 0; j < rest; ++j) out[i + j] = target + d * k[j];
+        if (rest) d *= k[rest - 1];
+        v = target + d;
+    }
+
+    *value = v;
+    *state = s;
+    return count;
+}
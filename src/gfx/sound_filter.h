@@ -11,19 +11,28 @@ typedef struct {
     f32 high_pass;
 } Sound_Filter_Result;
 
+// Cached coefficients of sound_filter
+static void sound_filter_coef(Sound *sound, f32 cutoff_freq, f32 *f, f32 *fb) {
+    Sound_Coef *coef = sound_var(sound, Sound_Coef);
+    f32 *feedback = sound_var(sound, f32);
+    if (sound_coef_changed(coef, cutoff_freq)) {
+        f32 rc = 1.0 / (cutoff_freq * PI2);
+        coef->value = SOUND_DT / (rc + SOUND_DT);
+
+        // The feedback does not matter for a cutoff of 0, because then f is 0
+        f32 q = 0.9;
+        *feedback = q + q / (1.0 - coef->value);
+    }
+    *f = coef->value;
+    *fb = *feedback;
+}
+
 // Filter the incoming samples at a given cutoff frequency.
 static Sound_Filter_Result sound_filter(Sound *sound, f32 cutoff_freq, f32 sample) {
     f32 *var0 = sound_var(sound, f32);
     f32 *var1 = sound_var(sound, f32);
-
-    f32 rc = 1.0 / (cutoff_freq * PI2);
-    f32 f = SOUND_DT / (rc + SOUND_DT);
-
-    // f and fb calculation
-    f32 q = 0.9;
-    f32 fb = q + q / (1.0 - f);
-
-    // loop
+    f32 f, fb;
+    sound_filter_coef(sound, cutoff_freq, &f, &fb);
 
     // High Pass Filter
     f32 hp = sample - *var0;
@@ -42,7 +51,7 @@ static Sound_Filter_Result sound_filter(Sound *sound, f32 cutoff_freq, f32 sampl
 
 static f32 sound_lowpass(Sound *sound, f32 cutoff_freq, f32 sample) {
     f32 *value = sound_var(sound, f32);
-    f32 a = 1.0f - f_exp(-SOUND_DT * PI2 * cutoff_freq);
+    f32 a = sound_coef_exp(sound_var(sound, Sound_Coef), PI2 * cutoff_freq);
     f32 ret = *value;
     *value += (sample - ret) * a;
     return ret;
@@ -182,3 +191,136 @@ static v2 sound_pan(Sound *sound, f32 sample, v3 dir) {
     if (gain < 1) out *= gain;
     return out;
 }
+
+// ==== Block processing ====
+
+// Same as sound_filter, outputs that are not needed can be 0
+static void sound_filter_block(Sound *sound, u32 count, f32 *low_pass, f32 *band_pass, f32 *high_pass, f32 cutoff_freq, f32 *in) {
+    f32 *var0 = sound_var(sound, f32);
+    f32 *var1 = sound_var(sound, f32);
+    f32 f, fb;
+    sound_filter_coef(sound, cutoff_freq, &f, &fb);
+
+    f32 v0 = *var0;
+    f32 v1 = *var1;
+    for (u32 i = 0; i < count; ++i) {
+        f32 hp = in[i] - v0;
+        f32 bp = v0 - v1;
+        v0 += f * (hp + fb * bp);
+        v1 += f * (v0 - v1);
+        if (low_pass) low_pass[i] = v1;
+        if (band_pass) band_pass[i] = bp;
+        if (high_pass) high_pass[i] = hp;
+    }
+    *var0 = v0;
+    *var1 = v1;
+}
+
+static void sound_lowpass_block(Sound *sound, u32 count, f32 *out, f32 cutoff_freq, f32 *in) {
+    f32 *value = sound_var(sound, f32);
+    f32 a = sound_coef_exp(sound_var(sound, Sound_Coef), PI2 * cutoff_freq);
+    f32 v = *value;
+    for (u32 i = 0; i < count; ++i) {
+        f32 sample = in[i];
+        out[i] = v;
+        v += (sample - v) * a;
+    }
+    *value = v;
+}
+
+// Same as sound_comb, but the output is added to 'out'
+// 'out' must not be 'in', the output would be fed back into the filter.
+static void sound_comb_block(Sound *sound, u32 count, f32 *out, u32 size, f32 damp, f32 feedback, f32 *in) {
+    f32 *buf = sound_vars(sound, f32, size);
+    f32 *filter = sound_var(sound, f32);
+    u32 *ix = sound_var(sound, u32);
+    assert0(out != in);
+
+    f32 f = *filter;
+    u32 j = *ix;
+    if (j >= size) j = 0;
+    for (u32 i = 0; i < count; ++i) {
+        f32 output = buf[j];
+        f += (output - f) * (1.0f - damp);
+        buf[j] = in[i] + feedback * f;
+        if (++j == size) j = 0;
+        out[i] += output;
+    }
+    *filter = f;
+    *ix = j;
+}
+
+static void sound_allpass_block(Sound *sound, u32 count, f32 *out, u32 size, f32 feedback, f32 *in) {
+    f32 *buf = sound_vars(sound, f32, size);
+    u32 *ix = sound_var(sound, u32);
+
+    u32 j = *ix;
+    if (j >= size) j = 0;
+    for (u32 i = 0; i < count; ++i) {
+        f32 input = in[i];
+        f32 output = buf[j];
+        buf[j] = input + feedback * output;
+        if (++j == size) j = 0;
+        out[i] = output - input;
+    }
+    *ix = j;
+}
+
+static void sound_delay_block(Sound *sound, u32 count, f32 *out, f32 time, f32 max, f32 *in) {
+    if (time > max) time = max;
+    if (time < 0) time = 0;
+
+    u32 size = max * SOUND_SAMPLE_RATE + 1;
+    u32 offset = time * SOUND_SAMPLE_RATE;
+    if (offset >= size) offset = size - 1;
+
+    f32 *samples = sound_vars(sound, f32, size);
+    u32 *ix = sound_var(sound, u32);
+
+    u32 j = *ix;
+    if (j >= size) j = 0;
+    for (u32 i = 0; i < count; ++i) {
+        samples[j] = in[i];
+        u32 j2 = j + size - offset;
+        if (j2 >= size) j2 -= size;
+        out[i] = samples[j2];
+        if (++j == size) j = 0;
+    }
+    *ix = j;
+}
+
+// Same as sound_pan, but the output is added to 'out'
+static void sound_pan_block(Sound *sound, u32 count, v2 *out, v3 dir, f32 *in) {
+    assert0(count <= SOUND_BLOCK_SIZE);
+
+    f32 distance_sq = v3_length_sq(dir);
+    f32 inv_distance = f_inv_sqrt(distance_sq);
+    dir *= inv_distance;
+
+    f32 scale = 0.6f / 1000 * 1;
+
+    f32 ang_right = f_max(-dir.x, 0);
+    f32 ang_left = f_max(dir.x, 0);
+
+    // x=left, y=right
+    f32 l[SOUND_BLOCK_SIZE];
+    f32 r[SOUND_BLOCK_SIZE];
+    f32 l_low[SOUND_BLOCK_SIZE];
+    f32 r_low[SOUND_BLOCK_SIZE];
+    sound_delay_block(sound, count, l, ang_right * scale, scale, in);
+    sound_delay_block(sound, count, r, ang_left * scale, scale, in);
+    sound_filter_block(sound, count, l_low, 0, 0, 2000, l);
+    sound_filter_block(sound, count, r_low, 0, 0, 2000, r);
+
+    f32 l_mix = ang_right - (dir.z + 1) / 2 * 0.5;
+    f32 r_mix = ang_left - (dir.z + 1) / 2 * 0.5;
+
+    f32 gain = distance_sq == 0 ? 1 : inv_distance;
+    if (gain > 1) gain = 1;
+
+    for (u32 i = 0; i < count; ++i) {
+        f32 out_l = l[i] + (l_low[i] - l[i]) * l_mix;
+        f32 out_r = r[i] + (r_low[i] - r[i]) * r_mix;
+        out[i] += (v2){out_l, out_r} * gain;
+    }
+}
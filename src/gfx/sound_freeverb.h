@@ -0,0 +1,203 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// sound_freeverb.h - Freeverb with the comb filters in SIMD lanes
+#pragma once
+#include "gfx/sound_filter.h"
+#include "gfx/sound_var.h"
+#include "lib/std.h"
+
+// Block version of sound_freeverb and sound_freeverb2.
+//
+// The 8 comb filters of a channel are independent and all read the same input.
+// - Every comb filter is a SIMD lane, so the damping filter of all combs of both channels is a single vector operation.
+//   That is 16 lanes, one register with AVX-512, two with AVX2.
+// - Every delay line is longer than a block, so all delayed samples of a block are read before any of them is written.
+// - The allpass filters are in series, so they are vectorized over the samples of the block instead.
+//
+// Sums are computed in the same order as the scalar version, so the output is (almost) identical.
+// See sound_freeverb_test() in sound_test.h.
+//
+// References:
+// - https://ccrma.stanford.edu/~jos/pasp/Freeverb.html
+// - https://github.com/sinshu/freeverb
+
+#define FREEVERB_COMBS 8
+#define FREEVERB_ALLPASSES 4
+#define FREEVERB_STEREO_SPREAD 23
+
+// Longest delay lines at 48 KHz, including the stereo spread
+#define FREEVERB_COMB_MAX 1800
+#define FREEVERB_ALLPASS_MAX 640
+
+// Delay line lengths at 44.1 KHz
+static const u32 FREEVERB_COMB_TUNING[FREEVERB_COMBS] = {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617};
+static const u32 FREEVERB_ALLPASS_TUNING[FREEVERB_ALLPASSES] = {556, 441, 341, 225};
+
+// One lane for every comb filter of both channels
+typedef f32 Freeverb_Lanes __attribute__((vector_size(FREEVERB_COMBS * 2 * sizeof(f32))));
+
+typedef struct {
+    // 1 for mono, 2 for stereo, 0 before the first block
+    u32 channels;
+    u32 spread;
+
+    // Left channel first, then the right channel
+    u32 comb_size[FREEVERB_COMBS * 2];
+    u32 comb_ix[FREEVERB_COMBS * 2];
+    f32 comb_filter[FREEVERB_COMBS * 2];
+    f32 comb[FREEVERB_COMBS * 2][FREEVERB_COMB_MAX];
+
+    u32 allpass_size[FREEVERB_ALLPASSES * 2];
+    u32 allpass_ix[FREEVERB_ALLPASSES * 2];
+    f32 allpass[FREEVERB_ALLPASSES * 2][FREEVERB_ALLPASS_MAX];
+} Freeverb;
+
+static Freeverb *freeverb_get(Sound *sound, u32 channels, u32 spread) {
+    Freeverb *fv = sound_var(sound, Freeverb);
+    if (fv->channels == channels && fv->spread == spread) return fv;
+
+    // Rescale factor for 44.1 KHz to 48 KHz
+    f32 a = (f32)SOUND_SAMPLE_RATE / 44100.0f;
+
+    fv->channels = channels;
+    fv->spread = spread;
+    for (u32 ch = 0; ch < channels; ++ch) {
+        u32 channel_spread = spread + ch * FREEVERB_STEREO_SPREAD;
+        for (u32 i = 0; i < FREEVERB_COMBS; ++i) {
+            u32 size = (FREEVERB_COMB_TUNING[i] + channel_spread) * a;
+            assert(size >= SOUND_BLOCK_SIZE && size <= FREEVERB_COMB_MAX, "Comb filter delay does not fit");
+            fv->comb_size[ch * FREEVERB_COMBS + i] = size;
+        }
+
+        for (u32 i = 0; i < FREEVERB_ALLPASSES; ++i) {
+            u32 size = (FREEVERB_ALLPASS_TUNING[i] + channel_spread) * a;
+            assert(size >= SOUND_BLOCK_SIZE && size <= FREEVERB_ALLPASS_MAX, "Allpass filter delay does not fit");
+            fv->allpass_size[ch * FREEVERB_ALLPASSES + i] = size;
+        }
+    }
+    return fv;
+}
+
+// Run all comb filters, 'out' receives the sum of the combs of every channel
+static void freeverb_comb(Freeverb *fv, u32 count, f32 out[2][SOUND_BLOCK_SIZE], f32 feedback, f32 damp, f32 *in) {
+    u32 comb_count = fv->channels * FREEVERB_COMBS;
+
+    // Delayed samples, transposed so that every comb is a lane
+    Freeverb_Lanes tap[SOUND_BLOCK_SIZE];
+    if (comb_count < FREEVERB_COMBS * 2) std_memzero((u8 *)tap, count * sizeof(Freeverb_Lanes));
+
+    // Read the delayed samples
+    for (u32 ch = 0; ch < fv->channels; ++ch) sound_block_fill(count, out[ch], 0.0f);
+    for (u32 c = 0; c < comb_count; ++c) {
+        f32 *buf = fv->comb[c];
+        f32 *sum = out[c / FREEVERB_COMBS];
+        u32 size = fv->comb_size[c];
+        u32 j = fv->comb_ix[c];
+        if (j >= size) j = 0;
+        for (u32 i = 0; i < count; ++i) {
+            f32 output = buf[j];
+            tap[i][c] = output;
+            sum[i] += output;
+            if (++j == size) j = 0;
+        }
+    }
+
+    // Damping filter and feedback of all combs at once
+    Freeverb_Lanes filter;
+    for (u32 c = 0; c < FREEVERB_COMBS * 2; ++c) filter[c] = fv->comb_filter[c];
+    f32 a = 1.0f - damp;
+    for (u32 i = 0; i < count; ++i) {
+        filter += (tap[i] - filter) * a;
+        tap[i] = in[i] + feedback * filter;
+    }
+    for (u32 c = 0; c < comb_count; ++c) fv->comb_filter[c] = filter[c];
+
+    // Write the new samples
+    for (u32 c = 0; c < comb_count; ++c) {
+        f32 *buf = fv->comb[c];
+        u32 size = fv->comb_size[c];
+        u32 j = fv->comb_ix[c];
+        if (j >= size) j = 0;
+        for (u32 i = 0; i < count; ++i) {
+            buf[j] = tap[i][c];
+            if (++j == size) j = 0;
+        }
+        fv->comb_ix[c] = j;
+    }
+}
+
+// Run the allpass filters of a channel in series, in place
+static void freeverb_allpass(Freeverb *fv, u32 count, u32 channel, f32 *samples) {
+    for (u32 k = channel * FREEVERB_ALLPASSES; k < (channel + 1) * FREEVERB_ALLPASSES; ++k) {
+        f32 *buf = fv->allpass[k];
+        u32 size = fv->allpass_size[k];
+        u32 j = fv->allpass_ix[k];
+        if (j >= size) j = 0;
+
+        // Process up to the end of the delay line, then wrap around
+        u32 i = 0;
+        while (i < count) {
+            u32 n = count - i;
+            if (n > size - j) n = size - j;
+
+            f32 *b = buf + j;
+            f32 *x = samples + i;
+            for (u32 s = 0; s < n; ++s) {
+                f32 input = x[s];
+                f32 output = b[s];
+                b[s] = input + 0.5f * output;
+                x[s] = output - input;
+            }
+
+            i += n;
+            j += n;
+            if (j == size) j = 0;
+        }
+        fv->allpass_ix[k] = j;
+    }
+}
+
+// Same as sound_freeverb
+// 'out' is only written after all of 'in' is read, so it can be processed in place.
+static void sound_freeverb_block(Sound *sound, u32 count, f32 *out, u32 spread, f32 feedback, f32 damp, f32 *in) {
+    assert0(count <= SOUND_BLOCK_SIZE);
+    Freeverb *fv = freeverb_get(sound, 1, spread);
+
+    f32 sum[2][SOUND_BLOCK_SIZE];
+    freeverb_comb(fv, count, sum, feedback, damp, in);
+    freeverb_allpass(fv, count, 0, sum[0]);
+    std_memcpy((u8 *)out, (u8 *)sum[0], count * sizeof(f32));
+}
+
+// Same as sound_freeverb2, processes 'buf' in place
+static void sound_freeverb2_block(Sound *sound, u32 count, v2 *buf, Freeverb_Config cfg) {
+    assert0(count <= SOUND_BLOCK_SIZE);
+    Freeverb *fv = freeverb_get(sound, 2, 0);
+
+    f32 width = 1.0f;
+    f32 gain = 0.015f;
+
+    // Tuned params
+    f32 room = cfg.room * 0.28f + 0.7f;
+    f32 damp = cfg.damp * 0.40f;
+    f32 wet = cfg.wet * 3.0f;
+    f32 dry = cfg.dry * 2.0f;
+
+    f32 wet_1 = wet * 0.5 * (width + 1);
+    f32 wet_2 = wet * 0.5 * (1 - width);
+
+    f32 input[SOUND_BLOCK_SIZE];
+    for (u32 i = 0; i < count; ++i) input[i] = (buf[i].x + buf[i].y) * gain;
+
+    f32 sum[2][SOUND_BLOCK_SIZE];
+    freeverb_comb(fv, count, sum, room, damp, input);
+    freeverb_allpass(fv, count, 0, sum[0]);
+    freeverb_allpass(fv, count, 1, sum[1]);
+
+    for (u32 i = 0; i < count; ++i) {
+        f32 l = sum[0][i];
+        f32 r = sum[1][i];
+        f32 out_l = l * wet_1 + r * wet_2 + buf[i].x * dry;
+        f32 out_r = r * wet_1 + l * wet_2 + buf[i].y * dry;
+        buf[i] = (v2){out_l, out_r};
+    }
+}
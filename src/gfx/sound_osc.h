@@ -84,3 +84,114 @@ static f32 sound_noise_freq(Sound *sound, f32 freq, f32 duty) {
     f32 ret = clk.phase < duty ? *value : 0.0;
     return ret;
 }
+
+// ==== Block processing ====
+
+// Linear ramp from [0, 1) at a given frequency
+// 'fm' multiplies the frequency per sample, pass 0 for a constant frequency.
+static void sound_phase_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm) {
+    f32 *phase = sound_var(sound, f32);
+    f32 value = *phase;
+    f32 step = SOUND_DT * freq;
+    if (fm) {
+        for (u32 i = 0; i < count; ++i) {
+            f32 next = value + step * fm[i];
+            out[i] = value;
+            value = f_fract(next);
+        }
+    } else {
+        // Not a recurrence, so this loop can be vectorized
+        for (u32 i = 0; i < count; ++i) out[i] = f_fract(value + step * i);
+        value = f_fract(value + step * count);
+    }
+    *phase = value;
+}
+
+static void sound_saw_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm) {
+    sound_phase_block(sound, count, out, freq, fm);
+    for (u32 i = 0; i < count; ++i) {
+        f32 v = out[i] + 0.5f;
+        if (v >= 1.0f) v -= 1.0f;
+        out[i] = v * 2.0f - 1.0f;
+    }
+}
+
+static void sound_pulse_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm, f32 duty) {
+    sound_phase_block(sound, count, out, freq, fm);
+    for (u32 i = 0; i < count; ++i) out[i] = out[i] < duty ? 1 : -1;
+}
+
+// Unaligned view of 8 samples
+typedef f32x8 Sound_Vec8 __attribute__((aligned(4), may_alias));
+
+// Uses the SIMD version of f_sin2pi, the samples are the same as with sound_sine.
+// See sound_sine_table_block for a table based sine.
+static void sound_sine_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm) {
+    sound_phase_block(sound, count, out, freq, fm);
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8) *(Sound_Vec8 *)(out + i) = f_sin2pi_8(*(Sound_Vec8 *)(out + i));
+    for (; i < count; ++i) out[i] = f_sin2pi(out[i]);
+}
+
+static void sound_triangle_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm) {
+    sound_phase_block(sound, count, out, freq, fm);
+    for (u32 i = 0; i < count; ++i) out[i] = f_min(out[i] * 4 - 1, 3 - out[i] * 4);
+}
+
+static void sound_noise_white_block(Sound *sound, u32 count, f32 *out) {
+    for (u32 i = 0; i < count; ++i) out[i] = rand_f32(&sound->rand, -1, 1);
+}
+
+// Same as sound_clock, but for a block of samples.
+// The clock only triggers on the first sample, 'count' (at least 1) is reduced to end the block before the next trigger.
+// A block that triggers is a single sample long, so envelopes gated by the trigger see the same single sample gate as with sound_clock.
+// 'phase' receives the clock phase for every sample, pass 0 if it is not needed.
+static Clock sound_clock_block(Sound *sound, u32 *count, f32 *phase, f32 freq, u32 cycle) {
+    f32 *value = sound_var(sound, f32);
+    u32 *index = sound_var(sound, u32);
+    f32 step = freq * SOUND_DT;
+
+    // First sample, identical to sound_clock
+    *value += step;
+    bool trigger = false;
+    while (*value >= 1.0f) {
+        *value -= 1.0;
+        *index += 1;
+        *index %= cycle;
+        trigger = true;
+    }
+
+    Clock ret = {};
+    ret.trigger = trigger;
+    ret.phase = *value;
+    ret.index = *index;
+
+    // Continue until the next trigger
+    u32 n = 1;
+    if (phase) phase[0] = *value;
+    while (!trigger && n < *count && *value + step < 1.0f) {
+        *value += step;
+        if (phase) phase[n] = *value;
+        n++;
+    }
+    *count = n;
+    return ret;
+}
+
+static void sound_noise_freq_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 duty) {
+    f32 *value = sound_var(sound, f32);
+    f32 *phase = sound_var(sound, f32);
+    f32 v = *value;
+    f32 p = *phase;
+    f32 step = freq * SOUND_DT;
+    for (u32 i = 0; i < count; ++i) {
+        p += step;
+        while (p >= 1.0f) {
+            p -= 1.0f;
+            v = rand_f32(&sound->rand, -1, 1);
+        }
+        out[i] = p < duty ? v : 0.0f;
+    }
+    *value = v;
+    *phase = p;
+}
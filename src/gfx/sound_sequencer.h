@@ -0,0 +1,239 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// sound_sequencer.h - Sample accurate MIDI playback
+#pragma once
+#include "gfx/midi.h"
+#include "gfx/sound_env.h"
+#include "gfx/sound_filter.h"
+#include "gfx/sound_wavetable.h"
+
+// Plays the notes of a Midi file with a simple saw synthesizer.
+//
+// - Note times are converted to sample indices once, so every track is an index sorted by start sample.
+//   Seeking is a binary search per track.
+// - Rendering splits the output at every note start and note end, so notes start on the exact sample.
+// - Every playing note has a voice with its own synthesis state.
+//   Voices return to the free list once their envelope is silent, so the cost only depends on the playing notes.
+// - All voices are allocated by sequencer_new, so the audio thread never allocates.
+
+// Number of notes that can play at the same time, after that the quietest voice is stolen
+#define SEQUENCER_VOICE_MAX 32
+
+// Immediate mode variables of a single voice
+#define SEQUENCER_VOICE_VARS 256
+
+typedef struct {
+    // Sample index of the note on and note off
+    u64 start;
+    u64 end;
+
+    f32 freq;
+    f32 volume;
+} Sequencer_Note;
+
+typedef struct {
+    // Sorted by start
+    u32 note_count;
+    Sequencer_Note *notes;
+
+    // Next note to start
+    u32 next;
+} Sequencer_Track;
+
+typedef struct Sequencer_Voice Sequencer_Voice;
+struct Sequencer_Voice {
+    Sound snd;
+    f32 freq;
+    f32 volume;
+
+    // Key is held until 'end'
+    bool down;
+    u64 end;
+
+    // Envelope at the end of the last block, 1 for a note that has not started yet
+    f32 level;
+
+    Sequencer_Voice *next;
+};
+
+typedef struct {
+    // Owns the voices and the shared wavetables
+    Sound snd;
+
+    u32 track_count;
+    Sequencer_Track *tracks;
+
+    // Playback position and the end of the last note, in samples
+    u64 time;
+    u64 length;
+
+    // Start again at the beginning after the last note
+    bool loop;
+
+    Sequencer_Voice *voice_list; // Playing
+    Sequencer_Voice *voice_free; // Silent, ready to be reused
+} Sequencer;
+
+// Frequency of a MIDI note number, note 69 is A4 at 440 Hz
+static f32 sequencer_note_freq(u32 note) {
+    return 440.0f * f_pow2(((f32)note - 69.0f) / 12.0f);
+}
+
+static Sequencer *sequencer_new(Memory *mem, Midi *midi) {
+    Sequencer *seq = mem_struct(mem, Sequencer);
+    seq->snd = sound_init(mem);
+    seq->track_count = midi->track_count;
+    seq->tracks = mem_array_zero(mem, Sequencer_Track, midi->track_count);
+
+    // Samples per tick, at a constant tempo
+    f64 tick = (f64)midi->tempo * SOUND_SAMPLE_RATE / 1e6 / midi->divisions;
+
+    u32 track_ix = 0;
+    for (Midi_Track *midi_track = midi->tracks; midi_track; midi_track = midi_track->next) {
+        Sequencer_Track *track = seq->tracks + track_ix++;
+        track->note_count = midi_track->note_count;
+        track->notes = mem_array_uninit(mem, Sequencer_Note, midi_track->note_count);
+        for (u32 i = 0; i < midi_track->note_count; ++i) {
+            Midi_Note *note = midi_track->notes + i;
+            Sequencer_Note *seq_note = track->notes + i;
+            seq_note->start = note->time * tick;
+            seq_note->end = (note->time + note->duration) * tick;
+            seq_note->freq = sequencer_note_freq(note->note);
+            seq_note->volume = note->vel / 127.0f;
+            if (seq_note->end > seq->length) seq->length = seq_note->end;
+        }
+    }
+
+    Sound_Wavetable *wavetable = sound_wavetable(&seq->snd);
+    for (u32 i = 0; i < SEQUENCER_VOICE_MAX; ++i) {
+        Sequencer_Voice *voice = mem_struct(mem, Sequencer_Voice);
+        voice->snd.imm = imm_new(mem, SEQUENCER_VOICE_VARS);
+        voice->snd.wavetable = wavetable;
+        voice->next = seq->voice_free;
+        seq->voice_free = voice;
+    }
+    return seq;
+}
+
+// Index of the first note that starts at or after 'time'
+static u32 sequencer_track_find(Sequencer_Track *track, u64 time) {
+    u32 low = 0;
+    u32 high = track->note_count;
+    while (low < high) {
+        u32 mid = low + (high - low) / 2;
+        if (track->notes[mid].start < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Continue playback at sample 'time'.
+// All playing notes are stopped, notes that started before 'time' are skipped.
+static void sequencer_seek(Sequencer *seq, u64 time) {
+    while (seq->voice_list) {
+        Sequencer_Voice *voice = seq->voice_list;
+        seq->voice_list = voice->next;
+        voice->next = seq->voice_free;
+        seq->voice_free = voice;
+    }
+
+    seq->time = time;
+    for (u32 i = 0; i < seq->track_count; ++i) {
+        seq->tracks[i].next = sequencer_track_find(seq->tracks + i, time);
+    }
+}
+
+// Get a voice for a new note, returns 0 if the note should be dropped
+static Sequencer_Voice *sequencer_voice_alloc(Sequencer *seq, f32 volume) {
+    Sequencer_Voice *voice = seq->voice_free;
+    if (voice) {
+        seq->voice_free = voice->next;
+    } else {
+        // Steal the quietest voice, it keeps playing from its current state
+        Sequencer_Voice *quiet = 0;
+        f32 quiet_level = volume;
+        for (Sequencer_Voice *other = seq->voice_list; other; other = other->next) {
+            f32 level = other->level * other->volume;
+            if (level >= quiet_level) continue;
+            quiet = other;
+            quiet_level = level;
+        }
+        return quiet;
+    }
+
+    voice->next = seq->voice_list;
+    seq->voice_list = voice;
+    return voice;
+}
+
+// Start and stop all notes at the current sample, returns the number of samples until the next note starts or stops
+static u64 sequencer_update(Sequencer *seq) {
+    u64 next = U64_MAX;
+
+    for (u32 i = 0; i < seq->track_count; ++i) {
+        Sequencer_Track *track = seq->tracks + i;
+        for (; track->next < track->note_count; track->next++) {
+            Sequencer_Note *note = track->notes + track->next;
+            if (note->start > seq->time) {
+                if (note->start < next) next = note->start;
+                break;
+            }
+
+            // Full level until it is rendered, so the other notes of a chord can't steal it
+            Sequencer_Voice *voice = sequencer_voice_alloc(seq, note->volume);
+            if (!voice) continue;
+            voice->level = 1.0f;
+            voice->freq = note->freq;
+            voice->volume = note->volume;
+            voice->down = true;
+            voice->end = note->end;
+        }
+    }
+
+    for (Sequencer_Voice *voice = seq->voice_list; voice; voice = voice->next) {
+        if (voice->down && voice->end <= seq->time) voice->down = false;
+        if (voice->down && voice->end < next) next = voice->end;
+    }
+
+    return next - seq->time;
+}
+
+// Add 'count' samples of the song to 'out'
+static void sequencer_render(Sequencer *seq, u32 count, f32 *out) {
+    f32 env[SOUND_BLOCK_SIZE];
+    f32 wave[SOUND_BLOCK_SIZE];
+
+    while (count > 0) {
+        // End the block at the next note start or note end
+        u32 block = u_min(count, SOUND_BLOCK_SIZE);
+        u64 next = sequencer_update(seq);
+        if (next < block) block = next;
+
+        for (Sequencer_Voice **link = &seq->voice_list; *link;) {
+            Sequencer_Voice *voice = *link;
+            Sound *vs = &voice->snd;
+            sound_begin(vs);
+            u32 n = sound_adsr_block(vs, block, env, voice->down, 200, 8, 0.5f);
+            sound_saw_table_block(vs, n, wave, voice->freq, 0);
+            sound_block_mul(n, wave, wave, env);
+            sound_lowpass_block(vs, n, wave, voice->freq * 4, wave);
+            sound_block_mix(n, out, wave, voice->volume);
+            voice->level = n ? env[n - 1] : 0.0f;
+
+            if (n == 0) {
+                *link = voice->next;
+                voice->next = seq->voice_free;
+                seq->voice_free = voice;
+            } else {
+                link = &voice->next;
+            }
+        }
+
+        out += block;
+        count -= block;
+        seq->time += block;
+        if (seq->loop && seq->time >= seq->length) sequencer_seek(seq, 0);
+    }
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include "gfx/sound.h"
+#include "lib/test.h"
+
+// Largest difference between two buffers
+static f32 sound_test_diff(u32 count, f32 *a, f32 *b) {
+    f32 diff = 0;
+    for (u32 i = 0; i < count; ++i) diff = f_max(diff, f_abs(a[i] - b[i]));
+    return diff;
+}
+
+// The block functions should produce the same samples as the immediate mode functions
+static void sound_block_test(Test *test) {
+    Sound scalar = sound_init(test->mem);
+    Sound block = sound_init(test->mem);
+
+    u32 count = 100;
+    f32 in[SOUND_BLOCK_SIZE];
+    f32 want[7][SOUND_BLOCK_SIZE];
+    f32 got[7][SOUND_BLOCK_SIZE];
+    v2 want_v2[2][SOUND_BLOCK_SIZE];
+    v2 got_v2[2][SOUND_BLOCK_SIZE];
+
+    f32 max_diff[10] = {};
+    Rand rand = rand_new(1234);
+    for (u32 iteration = 0; iteration < 32; ++iteration) {
+        // Hold the envelope for a while, then release
+        bool down = iteration < 4;
+        for (u32 i = 0; i < count; ++i) in[i] = rand_f32(&rand, -1, 1);
+
+        for (u32 i = 0; i < count; ++i) {
+            sound_begin(&scalar);
+            want[0][i] = sound_saw(&scalar, 440, 0);
+            want[1][i] = sound_sine(&scalar, 220, 0);
+            want[2][i] = sound_adsr(&scalar, down, 400, 4, 0.5f);
+            want[3][i] = sound_lowpass(&scalar, 1000, in[i]);
+            want[4][i] = sound_filter(&scalar, 2000, in[i]).band_pass;
+            want[5][i] = sound_freeverb(&scalar, 0, 0.9f, 0.1f, in[i]);
+            want[6][i] = sound_triangle(&scalar, 100, 0);
+            want_v2[0][i] = sound_freeverb2(&scalar, (Freeverb_Config){0.8f, 0.2f, 0.5f, 1.0f}, (v2){in[i], -in[i]});
+            want_v2[1][i] = sound_pan(&scalar, in[i], (v3){1, 0, 2});
+        }
+
+        sound_begin(&block);
+        sound_saw_block(&block, count, got[0], 440, 0);
+        sound_sine_block(&block, count, got[1], 220, 0);
+        sound_adsr_block(&block, count, got[2], down, 400, 4, 0.5f);
+        sound_lowpass_block(&block, count, got[3], 1000, in);
+        sound_filter_block(&block, count, 0, got[4], 0, 2000, in);
+        sound_freeverb_block(&block, count, got[5], 0, 0.9f, 0.1f, in);
+        sound_triangle_block(&block, count, got[6], 100, 0);
+        for (u32 i = 0; i < count; ++i) got_v2[0][i] = (v2){in[i], -in[i]};
+        sound_freeverb2_block(&block, count, got_v2[0], (Freeverb_Config){0.8f, 0.2f, 0.5f, 1.0f});
+        for (u32 i = 0; i < count; ++i) got_v2[1][i] = (v2){0, 0};
+        sound_pan_block(&block, count, got_v2[1], (v3){1, 0, 2}, in);
+
+        // In place, same as got[5]
+        f32 in_place[SOUND_BLOCK_SIZE];
+        for (u32 i = 0; i < count; ++i) in_place[i] = in[i];
+        sound_freeverb_block(&block, count, in_place, 0, 0.9f, 0.1f, in_place);
+        max_diff[9] = f_max(max_diff[9], sound_test_diff(count, got[5], in_place));
+
+        for (u32 j = 0; j < 7; ++j) max_diff[j] = f_max(max_diff[j], sound_test_diff(count, want[j], got[j]));
+        for (u32 i = 0; i < count; ++i) {
+            for (u32 j = 0; j < 2; ++j) {
+                v2 diff = want_v2[j][i] - got_v2[j][i];
+                max_diff[7 + j] = f_max(max_diff[7 + j], f_max(f_abs(diff.x), f_abs(diff.y)));
+            }
+        }
+    }
+
+    for (u32 j = 0; j < array_count(max_diff); ++j) TEST(max_diff[j] < 1e-3f);
+}
+
+// Run one second of noise bursts through the reverb with varying block sizes
+static void sound_freeverb_test(Test *test) {
+    Sound scalar = sound_init(test->mem);
+    Sound block = sound_init(test->mem);
+    Freeverb_Config cfg = {.room = 0.8f, .damp = 0.2f, .wet = 0.5f, .dry = 1.0f};
+
+    Rand rand = rand_new(42);
+    f32 max_diff = 0;
+    u32 sample = 0;
+    while (sample < SOUND_SAMPLE_RATE) {
+        u32 count = rand_u32(&rand, 1, SOUND_BLOCK_SIZE + 1);
+
+        v2 want[SOUND_BLOCK_SIZE];
+        v2 got[SOUND_BLOCK_SIZE];
+        for (u32 i = 0; i < count; ++i) {
+            // A short burst every 0.1 seconds
+            bool burst = (sample + i) % (SOUND_SAMPLE_RATE / 10) < 256;
+            f32 x = burst ? rand_f32(&rand, -1, 1) : 0;
+            got[i] = (v2){x, x * 0.5f};
+
+            sound_begin(&scalar);
+            want[i] = sound_freeverb2(&scalar, cfg, got[i]);
+        }
+
+        sound_begin(&block);
+        sound_freeverb2_block(&block, count, got, cfg);
+
+        for (u32 i = 0; i < count; ++i) {
+            v2 diff = want[i] - got[i];
+            max_diff = f_max(max_diff, f_max(f_abs(diff.x), f_abs(diff.y)));
+        }
+        sample += count;
+    }
+    TEST(max_diff < 1e-4f);
+}
+
+// A released envelope becomes silent, and reports that it skipped the block
+static void sound_silence_test(Test *test) {
+    Sound sound = sound_init(test->mem);
+    f32 out[SOUND_BLOCK_SIZE];
+
+    sound_begin(&sound);
+    TEST(sound_adsr_block(&sound, 64, out, true, 400, 100, 0) == 64);
+    TEST(out[63] > 0.5f);
+
+    u32 n = 64;
+    for (u32 i = 0; i < 100 && n > 0; ++i) {
+        sound_begin(&sound);
+        n = sound_adsr_block(&sound, 64, out, false, 400, 100, 0);
+    }
+    TEST(n == 0);
+    TEST(out[0] == 0);
+}
+
+// Low notes have enough harmonics to be close to the naive waves, high notes are only a sine
+static void sound_wavetable_test(Test *test) {
+    Sound naive = sound_init(test->mem);
+    Sound table = sound_init(test->mem);
+
+    f32 want[SOUND_BLOCK_SIZE];
+    f32 got[SOUND_BLOCK_SIZE];
+    f32 max_diff[2] = {};
+    f32 sum_diff[2] = {};
+    u32 count = 0;
+    for (u32 block = 0; block < 128; ++block) {
+        sound_begin(&naive);
+        sound_begin(&table);
+
+        sound_sine_block(&naive, SOUND_BLOCK_SIZE, want, 20, 0);
+        sound_sine_table_block(&table, SOUND_BLOCK_SIZE, got, 20, 0);
+        max_diff[0] = f_max(max_diff[0], sound_test_diff(SOUND_BLOCK_SIZE, want, got));
+
+        sound_triangle_block(&naive, SOUND_BLOCK_SIZE, want, 20, 0);
+        sound_triangle_table_block(&table, SOUND_BLOCK_SIZE, got, 20, 0);
+        max_diff[1] = f_max(max_diff[1], sound_test_diff(SOUND_BLOCK_SIZE, want, got));
+
+        // The saw and pulse waves ring around the jumps, so compare the average difference
+        sound_saw_block(&naive, SOUND_BLOCK_SIZE, want, 20, 0);
+        sound_saw_table_block(&table, SOUND_BLOCK_SIZE, got, 20, 0);
+        for (u32 i = 0; i < SOUND_BLOCK_SIZE; ++i) sum_diff[0] += f_abs(want[i] - got[i]);
+
+        sound_pulse_block(&naive, SOUND_BLOCK_SIZE, want, 20, 0, 0.25f);
+        sound_pulse_table_block(&table, SOUND_BLOCK_SIZE, got, 20, 0, 0.25f);
+        for (u32 i = 0; i < SOUND_BLOCK_SIZE; ++i) sum_diff[1] += f_abs(want[i] - got[i]);
+        count += SOUND_BLOCK_SIZE;
+    }
+
+    // f_sin2pi itself is accurate to about 1e-3
+    TEST(max_diff[0] < 2e-3f);
+    TEST(max_diff[1] < 1e-2f);
+    TEST(sum_diff[0] / count < 2e-2f);
+    TEST(sum_diff[1] / count < 2e-2f);
+
+    // Only the fundamental fits below the Nyquist frequency
+    sound_begin(&table);
+    sound_saw_table_block(&table, SOUND_BLOCK_SIZE, got, 15000, 0);
+    for (u32 i = 0; i < SOUND_BLOCK_SIZE; ++i) TEST(f_abs(got[i]) < 2.0f / PI + 1e-3f);
+}
+
+// Notes start on the exact sample, and the voices are released after the song
+static void sound_sequencer_test(Test *test) {
+    String file = midi_test_file();
+    Midi *midi = midi_read(test->mem, &file);
+    Sequencer *seq = sequencer_new(test->mem, midi);
+
+    // 96 ticks per quarter note at 120 BPM, so a tick is 250 samples
+    Sequencer_Track *track = seq->tracks;
+    TEST(seq->track_count == 1);
+    TEST(track->notes[1].start == 24000 && track->notes[1].end == 36000);
+    TEST(seq->length == 96000);
+
+    TEST(sequencer_track_find(track, 0) == 0);
+    TEST(sequencer_track_find(track, 24000) == 1);
+    TEST(sequencer_track_find(track, 24001) == 2);
+    TEST(sequencer_track_find(track, 96000) == 3);
+
+    // Seeking skips the first note
+    sequencer_seek(seq, 1000);
+    TEST(track->next == 1);
+
+    f32 *out = mem_array_zero(test->mem, f32, 23000 + 8);
+    sequencer_render(seq, 23000 + 8, out);
+    f32 before = 0;
+    f32 after = 0;
+    for (u32 i = 0; i < 23000; ++i) before += f_abs(out[i]);
+    for (u32 i = 23000; i < 23000 + 8; ++i) after += f_abs(out[i]);
+    TEST(before == 0);
+    TEST(after > 0);
+
+    // Everything is silent a few seconds after the last note
+    f32 *rest = mem_array_zero(test->mem, f32, SOUND_SAMPLE_RATE * 4);
+    sequencer_render(seq, SOUND_SAMPLE_RATE * 4, rest);
+    TEST(seq->voice_list == 0);
+
+    // All voices are playing, 4 of them quietly
+    for (u32 i = 0; i < SEQUENCER_VOICE_MAX; ++i) {
+        Sequencer_Voice *voice = sequencer_voice_alloc(seq, 1);
+        voice->volume = 1;
+        voice->level = i < 4 ? 0.1f : 1.0f;
+        voice->freq = 100;
+    }
+
+    // Every note of a chord steals a different quiet voice
+    Sequencer_Note chord[4];
+    for (u32 i = 0; i < 4; ++i) chord[i] = (Sequencer_Note){seq->time, seq->time + 1000, 200 + i, 0.5f};
+    Sequencer_Track chord_track = {.note_count = 4, .notes = chord};
+    seq->track_count = 1;
+    seq->tracks = &chord_track;
+    sequencer_update(seq);
+    u32 chord_count = 0;
+    for (Sequencer_Voice *voice = seq->voice_list; voice; voice = voice->next) chord_count += voice->freq >= 200;
+    TEST(chord_count == 4);
+}
+
+static void sound_test(Test *test) {
+    sound_block_test(test);
+    sound_freeverb_test(test);
+    sound_silence_test(test);
+    sound_wavetable_test(test);
+    sound_sequencer_test(test);
+}
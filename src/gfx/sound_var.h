@@ -2,18 +2,25 @@
 // sound_var.h - Immediate mode sound synthesis
 #pragma once
 #include "gfx/imm.h"
+#include "lib/math.h"
 #include "lib/mem.h"
 #include "lib/rand.h"
+#include "lib/std.h"
 #include "lib/types.h"
 
 #define SOUND_SAMPLE_RATE 48000
 #define SOUND_DT (1.0f / SOUND_SAMPLE_RATE)
 
 // ==== SOUND TYPE ====
+TYPEDEF_STRUCT(Sound_Wavetable);
+
 typedef struct {
     // For noise
     Rand rand;
 
+    // Shared oscillator tables, created on first use (see sound_wavetable.h)
+    Sound_Wavetable *wavetable;
+
     // Immediate mode memory
     Imm imm;
 } Sound;
@@ -36,3 +43,57 @@ static bool sound_first(Sound *snd) {
 
 #define sound_vars(snd, type, count) imm_array(&(snd)->imm, type, count)
 #define sound_var(snd, type) imm_struct(&(snd)->imm, type)
+
+// ==== Coefficients ====
+//
+// Cutoff frequencies and envelope rates are almost always constant,
+// but computing their coefficients needs an f_exp or a division.
+// The coefficient is stored next to the state and only recomputed when the parameter changes.
+// A zero initialized coefficient belongs to a parameter of 0.
+typedef struct {
+    f32 param;
+    f32 value;
+} Sound_Coef;
+
+// Returns true if the coefficient has to be recomputed for 'param'
+static bool sound_coef_changed(Sound_Coef *coef, f32 param) {
+    if (coef->param == param) return false;
+    coef->param = param;
+    return true;
+}
+
+// One pole smoothing coefficient for a rate in 1/s
+static f32 sound_coef_exp(Sound_Coef *coef, f32 rate) {
+    if (sound_coef_changed(coef, rate)) coef->value = 1.0f - f_exp(-rate * SOUND_DT);
+    return coef->value;
+}
+
+// ==== Block processing ====
+//
+// The '_block' variants generate 'count' samples at once.
+// Variables are only looked up once per block.
+// - Control inputs (gates, cutoff, pan direction) are constant within a block,
+//   split the block where they should change.
+// - Every call site still has to be reached in the same order on every iteration,
+//   so instead of skipping a call, pass a count of 0.
+// - Input and output buffers may be the same buffer, unless noted otherwise (see sound_comb_block).
+
+// Maximum number of samples in a block
+#define SOUND_BLOCK_SIZE 128
+
+// Envelopes below this volume are considered silent (-100 dB)
+#define SOUND_SILENCE 1e-5f
+
+static void sound_block_fill(u32 count, f32 *out, f32 value) {
+    for (u32 i = 0; i < count; ++i) out[i] = value;
+}
+
+// out = a * b
+static void sound_block_mul(u32 count, f32 *out, f32 *a, f32 *b) {
+    for (u32 i = 0; i < count; ++i) out[i] = a[i] * b[i];
+}
+
+// out += in * gain
+static void sound_block_mix(u32 count, f32 *out, f32 *in, f32 gain) {
+    for (u32 i = 0; i < count; ++i) out[i] += in[i] * gain;
+}
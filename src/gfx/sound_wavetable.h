@@ -0,0 +1,154 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// sound_wavetable.h - Band-limited wavetable oscillators
+#pragma once
+#include "gfx/sound_osc.h"
+#include "gfx/sound_var.h"
+
+// Table based versions of the block oscillators.
+//
+// The naive saw, triangle and pulse waves have harmonics far above the Nyquist frequency,
+// which fold back as inharmonic noise (aliasing). The tables are built from a sum of sines, and only contain
+// the harmonics that fit below the Nyquist frequency.
+// - Every octave has its own table, with fewer harmonics for higher octaves.
+// - Samples are linearly interpolated between table entries.
+// - The table is chosen by the base frequency of the block, 'fm' should stay close to 1.
+// - The pulse wave is the difference of two saw waves, so any duty cycle is band-limited.
+//
+// The tables are shared by all oscillators of a Sound and are created on first use.
+//
+// References:
+// - https://www.earlevel.com/main/2012/05/03/a-wavetable-oscillator-introduction/
+// - https://ccrma.stanford.edu/~juhan/vas.html
+
+// Entries per table, a power of two
+#define SOUND_WAVETABLE_SIZE 2048
+
+// Highest frequency of the first octave, every next octave doubles this
+#define SOUND_WAVETABLE_BASE 40.0f
+#define SOUND_WAVETABLE_OCTAVES 10
+
+struct Sound_Wavetable {
+    // One extra entry, so interpolation never has to wrap
+    f32 sine[SOUND_WAVETABLE_SIZE + 1];
+
+    // Indexed by octave, at phase 'p': 2p - 1
+    f32 saw[SOUND_WAVETABLE_OCTAVES][SOUND_WAVETABLE_SIZE + 1];
+
+    // Indexed by octave, at phase 'p': min(4p - 1, 3 - 4p)
+    f32 triangle[SOUND_WAVETABLE_OCTAVES][SOUND_WAVETABLE_SIZE + 1];
+};
+
+// Number of harmonics below the Nyquist frequency for the highest frequency of an octave
+static u32 sound_wavetable_harmonics(u32 octave) {
+    return (SOUND_SAMPLE_RATE / 2) / (SOUND_WAVETABLE_BASE * (1 << octave));
+}
+
+static void sound_wavetable_build(Sound_Wavetable *wt) {
+    u32 size = SOUND_WAVETABLE_SIZE;
+
+    // Exact sine, by rotating with a small angle
+    // sin(a) and cos(a) from their Taylor series, which converge quickly for small angles.
+    f64 a = PI2 / size;
+    f64 a2 = a * a;
+    f64 rot_s = a * (1 - a2 / 6 * (1 - a2 / 20 * (1 - a2 / 42)));
+    f64 rot_c = 1 - a2 / 2 * (1 - a2 / 12 * (1 - a2 / 30 * (1 - a2 / 56)));
+    f64 s = 0;
+    f64 c = 1;
+    for (u32 i = 0; i < size; ++i) {
+        wt->sine[i] = s;
+        f64 s_next = s * rot_c + c * rot_s;
+        f64 c_next = c * rot_c - s * rot_s;
+        s = s_next;
+        c = c_next;
+    }
+    wt->sine[size] = wt->sine[0];
+
+    // Fourier series, starting at the highest octave.
+    // Every lower octave is the octave above plus the harmonics that now fit.
+    // saw      = -2/pi   * sum(sin(2 pi n p) / n)
+    // triangle = -8/pi^2 * sum(cos(2 pi n p) / n^2) for odd n
+    u32 n = 1;
+    for (i32 octave = SOUND_WAVETABLE_OCTAVES - 1; octave >= 0; --octave) {
+        f32 *saw = wt->saw[octave];
+        f32 *triangle = wt->triangle[octave];
+        if (octave < SOUND_WAVETABLE_OCTAVES - 1) {
+            std_memcpy((u8 *)saw, (u8 *)wt->saw[octave + 1], sizeof(wt->saw[0]));
+            std_memcpy((u8 *)triangle, (u8 *)wt->triangle[octave + 1], sizeof(wt->triangle[0]));
+        }
+
+        u32 harmonics = sound_wavetable_harmonics(octave);
+        for (; n <= harmonics; ++n) {
+            f32 saw_gain = -2.0f / PI / n;
+            f32 triangle_gain = n % 2 ? -8.0f / (PI * PI) / (n * n) : 0.0f;
+            for (u32 i = 0; i < size; ++i) {
+                saw[i] += wt->sine[(n * i) % size] * saw_gain;
+                triangle[i] += wt->sine[(n * i + size / 4) % size] * triangle_gain;
+            }
+        }
+        saw[size] = saw[0];
+        triangle[size] = triangle[0];
+    }
+}
+
+static Sound_Wavetable *sound_wavetable(Sound *sound) {
+    if (!sound->wavetable) {
+        sound->wavetable = mem_struct(sound->imm.mem, Sound_Wavetable);
+        sound_wavetable_build(sound->wavetable);
+    }
+    return sound->wavetable;
+}
+
+// Octave table for a frequency
+static u32 sound_wavetable_octave(f32 freq) {
+    u32 octave = 0;
+    while (octave < SOUND_WAVETABLE_OCTAVES - 1 && f_abs(freq) > SOUND_WAVETABLE_BASE * (1 << octave)) octave++;
+    return octave;
+}
+
+// Interpolated table lookup at every phase in 'out' plus 'offset', in place. 'offset' should be in [0, 1].
+static void sound_wavetable_read(u32 count, f32 *out, f32 *table, f32 offset) {
+    for (u32 i = 0; i < count; ++i) {
+        f32 x = (out[i] + offset) * SOUND_WAVETABLE_SIZE;
+        u32 j = x;
+        f32 t = x - j;
+        j &= SOUND_WAVETABLE_SIZE - 1;
+        out[i] = table[j] + (table[j + 1] - table[j]) * t;
+    }
+}
+
+// Same as sound_sine_block
+static void sound_sine_table_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm) {
+    Sound_Wavetable *wt = sound_wavetable(sound);
+    sound_phase_block(sound, count, out, freq, fm);
+    sound_wavetable_read(count, out, wt->sine, 0.0f);
+}
+
+// Same as sound_saw_block, but band-limited
+static void sound_saw_table_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm) {
+    Sound_Wavetable *wt = sound_wavetable(sound);
+    sound_phase_block(sound, count, out, freq, fm);
+    sound_wavetable_read(count, out, wt->saw[sound_wavetable_octave(freq)], 0.5f);
+}
+
+// Same as sound_triangle_block, but band-limited
+static void sound_triangle_table_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm) {
+    Sound_Wavetable *wt = sound_wavetable(sound);
+    sound_phase_block(sound, count, out, freq, fm);
+    sound_wavetable_read(count, out, wt->triangle[sound_wavetable_octave(freq)], 0.0f);
+}
+
+// Same as sound_pulse_block, but band-limited
+// pulse(p) = 2 * duty - 1 - (saw(p) - saw(p - duty))
+static void sound_pulse_table_block(Sound *sound, u32 count, f32 *out, f32 freq, f32 *fm, f32 duty) {
+    assert0(count <= SOUND_BLOCK_SIZE);
+    Sound_Wavetable *wt = sound_wavetable(sound);
+    f32 *saw = wt->saw[sound_wavetable_octave(freq)];
+    duty = f_clamp(duty, 0, 1);
+
+    f32 delayed[SOUND_BLOCK_SIZE];
+    sound_phase_block(sound, count, out, freq, fm);
+    std_memcpy((u8 *)delayed, (u8 *)out, count * sizeof(f32));
+    sound_wavetable_read(count, out, saw, 0.0f);
+    sound_wavetable_read(count, delayed, saw, 1.0f - duty);
+    for (u32 i = 0; i < count; ++i) out[i] = 2 * duty - 1 - (out[i] - delayed[i]);
+}
@@ -49,6 +49,7 @@ typedef struct {
 
 static Packer *packer_new(u32 texture_size) {
     Memory *mem = mem_new();
+    mem_set_name(mem, "packer");
     Packer *pack = mem_struct(mem, Packer);
     pack->mem = mem;
     pack->texture_size = texture_size;
@@ -1,5 +1,5 @@
 #pragma once
-#include "lib/chunk.h"
+#include "lib/mem.h"
 #include "lib/test.h"
 
 static void chunk_test(Test *test) {
@@ -24,3 +24,111 @@ static void chunk_test(Test *test) {
     TEST(chunk_c == chunk_b);
     TEST(chunk_d == chunk_a);
 }
+
+static void chunk_cache_test(Test *test) {
+    u32 count = CHUNK_BATCH_SIZE * 3;
+
+    // Free a lot of chunks at once
+    Chunk *list = 0;
+    for (u32 i = 0; i < count; ++i) {
+        Chunk *chunk = chunk_alloc();
+        LIST_PUSH(list, chunk);
+    }
+    chunk_free(list);
+
+    // The private cache stays small, the rest is moved to the global stack
+    TEST(CHUNK_CACHE.count < CHUNK_BATCH_SIZE * 2);
+    TEST(chunk_stack_ptr(G->chunk_cache) != 0);
+
+    // All chunks can be allocated again, without asking the OS for more memory
+    u64 alloc_size = G->stat_alloc_size;
+    list = 0;
+    for (u32 i = 0; i < count; ++i) {
+        Chunk *chunk = chunk_alloc();
+        LIST_PUSH(list, chunk);
+    }
+    TEST(G->stat_alloc_size == alloc_size);
+    chunk_free(list);
+
+    // Releasing the private cache moves everything to the global stack
+    chunk_cache_release();
+    TEST(CHUNK_CACHE.count == 0);
+    TEST(CHUNK_CACHE.first == 0);
+}
+
+static void chunk_trim_test(Test *test) {
+    u32 count = CHUNK_BATCH_SIZE * 4;
+
+    // Chunks in huge page slabs are never trimmed, so map these chunks separately
+    u32 pages = G->chunk_pages;
+    G->chunk_pages = OS_Pages_Normal;
+    Chunk *list = 0;
+    for (u32 i = 0; i < count; ++i) {
+        Chunk *chunk = chunk_slab_alloc();
+        TEST(chunk_trimmable(chunk));
+        ((u8 *)chunk)[CHUNK_SIZE - 1] = 'Z';
+        LIST_PUSH(list, chunk);
+    }
+    G->chunk_pages = pages;
+
+    // chunk_alloc normally does the accounting
+    G->stat_alloc_size += (u64)count * CHUNK_SIZE;
+    chunk_free(list);
+    chunk_cache_release();
+
+    // Release some cached memory, only the released bytes are counted
+    u64 trim_size = G->stat_trim_size;
+    u64 trimmed = chunk_cache_trim_size(CHUNK_BATCH_SIZE * CHUNK_TRIM_RELEASE);
+    TEST(trimmed >= CHUNK_BATCH_SIZE * CHUNK_TRIM_RELEASE);
+    TEST(trimmed % CHUNK_TRIM_RELEASE == 0);
+    TEST(G->stat_trim_size - trim_size == trimmed);
+    TEST(chunk_cache_resident() == G->stat_cache_size - G->stat_trim_size);
+
+    // Trimmed chunks can be used again, before new memory is requested
+    u64 alloc_size = G->stat_alloc_size;
+    list = 0;
+    while (G->stat_trim_size > trim_size && G->stat_alloc_size == alloc_size) {
+        Chunk *chunk = chunk_alloc();
+        ((u8 *)chunk)[CHUNK_SIZE - 1] = 'A';
+        TEST(((u8 *)chunk)[CHUNK_SIZE - 1] == 'A');
+        LIST_PUSH(list, chunk);
+    }
+    TEST(G->stat_alloc_size == alloc_size);
+    TEST(G->stat_trim_size == trim_size);
+    chunk_free(list);
+}
+
+static void chunk_slab_test(Test *test) {
+    // Other platforms have no huge pages, and always map chunks separately
+    if (!OS_IS_LINUX) return;
+
+    u32 pages = G->chunk_pages;
+    G->chunk_pages = OS_Pages_Transparent;
+
+    // Start a new slab
+    G->slab_next = G->slab_end;
+    u64 map_count = G->stat_map_count;
+    u64 huge_size = G->stat_huge_size + G->stat_thp_size;
+    Chunk *chunk_a = chunk_slab_alloc();
+    Chunk *chunk_b = chunk_slab_alloc();
+
+    // Chunks are carved from the same mapping
+    TEST(G->stat_map_count == map_count + 1);
+    TEST((u8 *)chunk_b == (u8 *)chunk_a + CHUNK_SIZE);
+    TEST(G->slab_end - G->slab_next == CHUNK_SLAB_SIZE - 2 * CHUNK_SIZE);
+
+    // Chunks in a huge page slab are never trimmed
+    bool huge = G->stat_huge_size + G->stat_thp_size != huge_size;
+    TEST(chunk_trimmable(chunk_a) == !huge);
+    TEST(chunk_trimmable(chunk_b) == !huge);
+
+    ((u8 *)chunk_b)[CHUNK_SIZE - 1] = 'Z';
+    TEST(((u8 *)chunk_b)[CHUNK_SIZE - 1] == 'Z');
+
+    // Slab chunks are normal chunks (chunk_alloc normally does the accounting)
+    G->stat_alloc_size += 2 * CHUNK_SIZE;
+    chunk_a->next = chunk_b;
+    chunk_b->next = 0;
+    chunk_free(chunk_a);
+    G->chunk_pages = pages;
+}
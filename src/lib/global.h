@@ -1,17 +1,19 @@
 // Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
 // global.h - Global state that is preserved between hot-reloads
 #pragma once
+#include "lib/mutex.h"
 #include "lib/types.h"
 
 // Forward declare types
 // The definitions are defined in each module
-typedef struct App App;       // Defined in "main.c"
-typedef struct Fmt Fmt;       // Defined in "fmt.h"
-typedef struct Rand Rand;     // Defined in "rand.h"
-typedef struct Chunk Chunk;   // Defined in "chunk.h"
-typedef struct Memory Memory; // Defined in "memory.h"
+typedef struct App App;               // Defined in "main.c"
+typedef struct Fmt Fmt;               // Defined in "fmt.h"
+typedef struct Rand Rand;             // Defined in "rand.h"
+typedef struct Chunk Chunk;           // Defined in "chunk.h"
+typedef struct Memory Memory;         // Defined in "memory.h"
+typedef struct Job_System Job_System; // Defined in "job.h"
 
-// NOTE: Only use global in the main thread
+// NOTE: Only use global in the main thread (except for the chunk cache)
 typedef struct {
     bool reloaded;
 
@@ -37,11 +39,46 @@ typedef struct {
     Rand *rand;
 
     // Memory chunck cache. Used internally to track free memory.
-    // Used in "chunk.h"
-    Chunk *chunk_cache;
+    // Lock-free stack of free chunk batches, shared by all threads.
+    // These members are only accessed atomically and can be used from any thread.
+    // Used in "mem.h"
+    u64 chunk_cache;
     u64 stat_alloc_size;
     u64 stat_cache_size;
 
+    // Cached chunks that were given back to the operating system (see chunk_cache_trim)
+    // Resident memory = stat_alloc_size - stat_trim_size
+    u64 chunk_trimmed;
+    u64 stat_trim_size;
+
+    // Trim policy state, main thread only
+    u64 trim_low;
+    u32 trim_frame;
+
+    // Chunks can be carved from big slabs backed by huge pages (see chunk_slab_alloc)
+    // Type of pages to use for new slabs, see OS_Pages in "os_alloc.h"
+    // OS_Pages_Normal (the default) maps every chunk individually.
+    u32 chunk_pages;
+    Mutex slab_mutex;
+    u8 *slab_next;
+    u8 *slab_end;
+
+    // Slabs that are backed by huge pages, their chunks are never trimmed (see chunk_trimmable)
+    u32 slab_huge_count;
+    u8 *slab_huge[64];
+
+    // Number of memory mappings created for chunks and bytes backed by each type of huge page
+    u64 stat_map_count;
+    u64 stat_huge_size;
+    u64 stat_thp_size;
+
+    // Registry of all named memory arenas (see mem_set_name)
+    Mutex mem_list_mutex;
+    Memory *mem_list;
+
+    // Worker threads, started with job_init()
+    Job_System *job;
+
     // Global permanent memory
     Memory *mem;
 
@@ -0,0 +1,457 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// job.h - Work stealing thread pool
+#pragma once
+#include "lib/global.h"
+#include "lib/mem.h"
+#include "lib/mutex.h"
+#include "lib/os_api.h"
+#include "lib/test.h"
+#include "lib/types.h"
+
+// Jobs are small functions that run in parallel on a pool of worker threads.
+// - Every worker owns a Chase-Lev deque, it pushes and pops jobs at the bottom.
+// - Idle workers steal jobs from the top of other deques.
+// - Threads that are not workers (or after a hot reload) push to a shared queue.
+// - Job_Group counts unfinished jobs, the thread waiting on a group helps running jobs.
+// - Without job_init() (and on wasm) every job runs immediately on the calling thread.
+//
+// Memory arenas are not thread safe, jobs should only read shared data and write to their own part of the output.
+// If a job needs to allocate, it should create its own arena.
+//
+// References:
+// - [Dynamic Circular Work-Stealing Deque - Chase, Lev](https://dl.acm.org/doi/10.1145/1073970.1073974)
+// - [Correct and Efficient Work-Stealing for Weak Memory Models - Lê et al.](https://fzn.fr/readings/ppopp13.pdf)
+
+// Maximum number of jobs in a single deque, pushing to a full deque runs the job directly
+#define JOB_DEQUE_SIZE 256
+#define JOB_MAX_WORKERS 64
+
+// Number of failed attempts to find work before a worker goes to sleep
+#define JOB_SPIN_COUNT 1024
+
+// A job calls 'func' for each index in [start, start + count)
+typedef void Job_Func(void *data, u32 index);
+
+// Counts the number of unfinished jobs, see job_wait()
+typedef struct {
+    volatile u32 pending;
+} Job_Group;
+
+typedef struct {
+    Job_Func *func;
+    void *data;
+    Job_Group *group;
+    u32 start;
+    u32 count;
+} Job;
+
+// Chase-Lev work stealing deque with a fixed size
+// 'top' and 'bottom' only grow, the slot is the index modulo JOB_DEQUE_SIZE.
+// The indices are padded to keep them on separate cache lines.
+// Memory is only 16 byte aligned, so we can't use alignas(64).
+typedef struct {
+    // Thieves take from the top
+    volatile i64 top;
+    u8 pad0[120];
+
+    // The owner pushes and pops at the bottom
+    volatile i64 bottom;
+    u8 pad1[120];
+
+    Job jobs[JOB_DEQUE_SIZE];
+} Job_Deque;
+
+typedef struct {
+    Job_Deque deque;
+    u32 index;
+
+    // Used to choose a random victim to steal from
+    u32 rng;
+} Job_Worker;
+
+struct Job_System {
+    u32 worker_count;
+    Job_Worker *workers;
+
+    // Jobs pushed by threads that are not a worker
+    Mutex shared_mutex;
+    u32 shared_read;
+    u32 shared_write;
+    Job shared[JOB_DEQUE_SIZE];
+
+    // Sleeping workers wait until 'wake' changes
+    volatile u32 wake;
+    volatile u32 sleeping;
+
+#if OS_IS_WINDOWS
+    HANDLE semaphore;
+#endif
+};
+
+// The worker that is running on this thread (0 for the main thread before job_init)
+#if OS_IS_WASM
+// Webassembly is single threaded
+static Job_Worker *JOB_WORKER;
+#else
+static _Thread_local Job_Worker *JOB_WORKER;
+#endif
+
+static void job_pause(void) {
+#if !OS_IS_WASM
+    __asm__ __volatile__("pause");
+#endif
+}
+
+// ==== Deque ====
+
+// Push a job at the bottom, only called by the owner
+static bool job_deque_push(Job_Deque *deque, Job job) {
+    i64 b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    i64 t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if (b - t >= JOB_DEQUE_SIZE) return false;
+    deque->jobs[b % JOB_DEQUE_SIZE] = job;
+    __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Pop the most recently pushed job, only called by the owner
+static bool job_deque_pop(Job_Deque *deque, Job *job) {
+    i64 b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 t = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    // Empty
+    if (t > b) {
+        __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *job = deque->jobs[b % JOB_DEQUE_SIZE];
+    if (t < b) return true;
+
+    // This was the last job, race against the thieves for it
+    bool won = __atomic_compare_exchange_n(&deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+    return won;
+}
+
+// Take the oldest job, can be called by any thread
+static bool job_deque_steal(Job_Deque *deque, Job *job) {
+    i64 t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 b = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return false;
+
+    // The slot can only be reused by the owner after 'top' moved past it,
+    // in that case the compare exchange fails and the copy is discarded.
+    *job = deque->jobs[t % JOB_DEQUE_SIZE];
+    return __atomic_compare_exchange_n(&deque->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+// ==== Sleeping ====
+
+// Wait until job_wake() is called, or 'wake' changed since it was read
+static void job_sleep(Job_System *sys, u32 wake) {
+#if OS_IS_LINUX
+    linux_futex(&sys->wake, FUTEX_WAIT_PRIVATE, wake, 0);
+#elif OS_IS_WINDOWS
+    WaitForSingleObject(sys->semaphore, INFINITE);
+#endif
+}
+
+// Wake a single sleeping worker
+static void job_wake(Job_System *sys) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&sys->sleeping, __ATOMIC_RELAXED) == 0) return;
+    __atomic_fetch_add(&sys->wake, 1, __ATOMIC_SEQ_CST);
+#if OS_IS_LINUX
+    linux_futex(&sys->wake, FUTEX_WAKE_PRIVATE, 1, 0);
+#elif OS_IS_WINDOWS
+    ReleaseSemaphore(sys->semaphore, 1, 0);
+#endif
+}
+
+// ==== Scheduling ====
+
+static void job_run(Job job) {
+    for (u32 i = 0; i < job.count; ++i) {
+        job.func(job.data, job.start + i);
+    }
+    __atomic_fetch_sub(&job.group->pending, 1, __ATOMIC_RELEASE);
+}
+
+// Find a job to run, first our own, then the shared queue, then steal from the other workers
+static bool job_find(Job_System *sys, Job *job) {
+    Job_Worker *self = JOB_WORKER;
+    if (self && job_deque_pop(&self->deque, job)) return true;
+
+    if (__atomic_load_n(&sys->shared_read, __ATOMIC_RELAXED) != __atomic_load_n(&sys->shared_write, __ATOMIC_RELAXED)) {
+        bool found = false;
+        mutex_lock(&sys->shared_mutex);
+        if (sys->shared_read != sys->shared_write) {
+            *job = sys->shared[sys->shared_read % JOB_DEQUE_SIZE];
+            sys->shared_read++;
+            found = true;
+        }
+        mutex_unlock(&sys->shared_mutex);
+        if (found) return true;
+    }
+
+    // Start at a random worker, so thieves don't all fight over the same deque
+    u32 start = 0;
+    if (self) {
+        self->rng = self->rng * 1664525 + 1013904223;
+        start = self->rng >> 16;
+    }
+
+    for (u32 i = 0; i < sys->worker_count; ++i) {
+        Job_Worker *victim = &sys->workers[(start + i) % sys->worker_count];
+        if (victim == self) continue;
+        if (job_deque_steal(&victim->deque, job)) return true;
+    }
+    return false;
+}
+
+// Push a job that calls 'func(data, i)' for every i in [start, start + count)
+static void job_push(Job_Group *group, Job_Func *func, void *data, u32 start, u32 count) {
+    Job job = {
+        .func = func,
+        .data = data,
+        .group = group,
+        .start = start,
+        .count = count,
+    };
+
+    __atomic_fetch_add(&group->pending, 1, __ATOMIC_RELAXED);
+
+    // Single threaded, run it now
+    Job_System *sys = G->job;
+    if (!sys) {
+        job_run(job);
+        return;
+    }
+
+    Job_Worker *self = JOB_WORKER;
+    bool pushed = false;
+    if (self) {
+        pushed = job_deque_push(&self->deque, job);
+    } else {
+        mutex_lock(&sys->shared_mutex);
+        if (sys->shared_write - sys->shared_read < JOB_DEQUE_SIZE) {
+            sys->shared[sys->shared_write % JOB_DEQUE_SIZE] = job;
+            sys->shared_write++;
+            pushed = true;
+        }
+        mutex_unlock(&sys->shared_mutex);
+    }
+
+    // The queue is full, run it now
+    if (!pushed) {
+        job_run(job);
+        return;
+    }
+
+    job_wake(sys);
+}
+
+// Wait until all jobs in this group are finished, runs other jobs while waiting
+static void job_wait(Job_Group *group) {
+    Job_System *sys = G->job;
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        Job job;
+        if (sys && job_find(sys, &job)) {
+            job_run(job);
+        } else {
+            job_pause();
+        }
+    }
+}
+
+// Call 'func(data, i)' for every i in [0, count) in parallel
+// Indices are grouped into jobs of 'batch' indices, 0 chooses a batch size automatically.
+// Call job_wait() on the group to wait for the result.
+static void job_for(Job_Group *group, u32 count, u32 batch, Job_Func *func, void *data) {
+    u32 workers = G->job ? G->job->worker_count : 1;
+    if (batch == 0) batch = count / (workers * 4);
+    if (batch == 0) batch = 1;
+
+    for (u32 start = 0; start < count; start += batch) {
+        u32 n = count - start;
+        if (n > batch) n = batch;
+        job_push(group, func, data, start, n);
+    }
+}
+
+// ==== Threads ====
+
+static void job_worker_main(Job_Worker *worker) {
+    Job_System *sys = G->job;
+    JOB_WORKER = worker;
+
+    u32 fail_count = 0;
+    for (;;) {
+        Job job;
+        if (job_find(sys, &job)) {
+            job_run(job);
+            fail_count = 0;
+            continue;
+        }
+
+        if (++fail_count < JOB_SPIN_COUNT) {
+            job_pause();
+            continue;
+        }
+
+        // Announce that we are going to sleep, then check one last time.
+        // A job pushed after this check will see 'sleeping' and wake us.
+        u32 wake = __atomic_load_n(&sys->wake, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&sys->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (job_find(sys, &job)) {
+            __atomic_fetch_sub(&sys->sleeping, 1, __ATOMIC_SEQ_CST);
+            job_run(job);
+            fail_count = 0;
+            continue;
+        }
+        job_sleep(sys, wake);
+        __atomic_fetch_sub(&sys->sleeping, 1, __ATOMIC_SEQ_CST);
+        fail_count = 0;
+    }
+}
+
+#if OS_IS_LINUX
+static void *job_thread_linux(void *arg) {
+    job_worker_main(arg);
+    return 0;
+}
+#elif OS_IS_WINDOWS
+static DWORD WINAPI job_thread_windows(LPVOID arg) {
+    job_worker_main(arg);
+    return 0;
+}
+#endif
+
+// Number of cpu cores we can use
+static u32 job_cpu_count(void) {
+#if OS_IS_LINUX
+    u64 mask[16] = {};
+    i32 size = linux_sched_getaffinity(0, sizeof(mask), mask);
+    if (size <= 0) return 1;
+    u32 count = 0;
+    for (u32 i = 0; i < (u32)size / 8; ++i) count += __builtin_popcountll(mask[i]);
+    return count;
+#elif OS_IS_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    return 1;
+#endif
+}
+
+// Start the worker threads, the calling thread becomes worker 0
+// 'worker_count' includes the calling thread, 0 uses one worker per cpu core.
+//
+// NOTE: After a hot reload the thread locals are reset, the main thread then uses the shared queue.
+static void job_init(u32 worker_count) {
+    if (G->job) return;
+    if (OS_IS_WASM) return;
+
+    if (worker_count == 0) worker_count = job_cpu_count();
+    if (worker_count > JOB_MAX_WORKERS) worker_count = JOB_MAX_WORKERS;
+    if (worker_count < 1) worker_count = 1;
+
+    Job_System *sys = mem_struct(G->mem, Job_System);
+    sys->worker_count = worker_count;
+    sys->workers = mem_array_zero(G->mem, Job_Worker, worker_count);
+    for (u32 i = 0; i < worker_count; ++i) {
+        sys->workers[i].index = i;
+        sys->workers[i].rng = i * 0x9e3779b9 + 1;
+    }
+#if OS_IS_WINDOWS
+    sys->semaphore = CreateSemaphoreA(0, 0, JOB_MAX_WORKERS, 0);
+#endif
+
+    G->job = sys;
+    JOB_WORKER = &sys->workers[0];
+
+    for (u32 i = 1; i < worker_count; ++i) {
+#if OS_IS_LINUX
+        u64 thread;
+        pthread_create(&thread, 0, job_thread_linux, &sys->workers[i]);
+#elif OS_IS_WINDOWS
+        CreateThread(0, 0, job_thread_windows, &sys->workers[i], 0, 0);
+#endif
+    }
+}
+
+// ==== Tests ====
+
+static void job_test_count(void *data, u32 index) {
+    u32 *counts = data;
+    __atomic_fetch_add(&counts[index], 1, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+    u32 *counts;
+    u32 inner;
+} Job_Test_Nested;
+
+// Every job starts more jobs and waits for them
+static void job_test_nested(void *data, u32 index) {
+    Job_Test_Nested *nested = data;
+    Job_Group group = {};
+    job_for(&group, nested->inner, 1, job_test_count, nested->counts + index * nested->inner);
+    job_wait(&group);
+}
+
+static void job_test(Test *test) {
+    Job_Deque *deque = mem_struct(test->mem, Job_Deque);
+    Job job = {};
+
+    // The owner pops in LIFO order, thieves steal in FIFO order
+    for (u32 i = 0; i < 4; ++i) job_deque_push(deque, (Job){.start = i});
+    TEST(job_deque_pop(deque, &job) && job.start == 3);
+    TEST(job_deque_steal(deque, &job) && job.start == 0);
+    TEST(job_deque_pop(deque, &job) && job.start == 2);
+    TEST(job_deque_steal(deque, &job) && job.start == 1);
+    TEST(!job_deque_pop(deque, &job));
+    TEST(!job_deque_steal(deque, &job));
+
+    // A full deque rejects new jobs
+    for (u32 i = 0; i < JOB_DEQUE_SIZE; ++i) job_deque_push(deque, (Job){.start = i});
+    TEST(!job_deque_push(deque, (Job){}));
+
+    u32 count = 100 * 1000;
+    u32 *counts = mem_array_zero(test->mem, u32, count);
+
+    // Without worker threads everything runs directly
+    Job_System *sys = G->job;
+    G->job = 0;
+    Job_Group group = {};
+    job_for(&group, 100, 0, job_test_count, counts);
+    TEST(group.pending == 0);
+    job_wait(&group);
+    G->job = sys;
+
+    // Every index is visited exactly once
+    job_init(4);
+    TEST(G->job != 0);
+    std_memzero((u8 *)counts, count * sizeof(u32));
+    job_for(&group, count, 0, job_test_count, counts);
+    job_for(&group, count, 7, job_test_count, counts);
+    job_wait(&group);
+    bool all_twice = true;
+    for (u32 i = 0; i < count; ++i) all_twice &= counts[i] == 2;
+    TEST(group.pending == 0);
+    TEST(all_twice);
+
+    // Jobs can push and wait for other jobs
+    std_memzero((u8 *)counts, count * sizeof(u32));
+    Job_Test_Nested nested = {counts, 1000};
+    job_for(&group, count / nested.inner, 1, job_test_nested, &nested);
+    job_wait(&group);
+    bool all_once = true;
+    for (u32 i = 0; i < count; ++i) all_once &= counts[i] == 1;
+    TEST(all_once);
+}
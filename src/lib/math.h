@@ -133,6 +133,38 @@ static f32 f_cos2pi(f32 x) {
     return f_sin2pi(x + .25f);
 }
 
+// ==== SIMD trigonometric functions ====
+
+typedef f32 f32x4 __attribute__((vector_size(4 * sizeof(f32))));
+typedef f32 f32x8 __attribute__((vector_size(8 * sizeof(f32))));
+typedef i32 i32x4 __attribute__((vector_size(4 * sizeof(i32))));
+typedef i32 i32x8 __attribute__((vector_size(8 * sizeof(i32))));
+
+// Same polynomial as f_sin2pi for 4 or 8 values at once, without branches.
+// Every lane gives exactly the same result as f_sin2pi.
+// - floor: truncate, then subtract one where truncation rounded up (compares are 0 or -1)
+// - abs: clear the sign bit
+#define F_SIN2PI_N(x, f32xn, i32xn)                                                                                                                  \
+    do {                                                                                                                                             \
+        f32xn h = x + .5f;                                                                                                                           \
+        f32xn t = __builtin_convertvector(__builtin_convertvector(h, i32xn), f32xn);                                                                 \
+        x = x - (t + __builtin_convertvector(h < t, f32xn));                                                                                         \
+        f32xn x_abs = (f32xn)((i32xn)x & 0x7fffffff);                                                                                                \
+        f32xn y = 8 * x - 16 * x * x_abs;                                                                                                            \
+        f32xn y_abs = (f32xn)((i32xn)y & 0x7fffffff);                                                                                                \
+        x = 0.225f * (y * y_abs - y) + y;                                                                                                            \
+    } while (0)
+
+static f32x4 f_sin2pi_4(f32x4 x) {
+    F_SIN2PI_N(x, f32x4, i32x4);
+    return x;
+}
+
+static f32x8 f_sin2pi_8(f32x8 x) {
+    F_SIN2PI_N(x, f32x8, i32x8);
+    return x;
+}
+
 static f32 f_sin(f32 x) {
     return f_sin2pi(x * 1.0f / PI2);
 }
@@ -101,6 +101,18 @@ static void math_test(Test *test) {
     TEST(is_near(f_pow2(-4), 1 / 16.0f));
     TEST(is_near(f_pow2(4), 16.0));
 
+    // Every lane is the same as f_sin2pi
+    for (u32 i = 0; i < 256; i += 8) {
+        f32x8 x8;
+        for (u32 j = 0; j < 8; ++j) x8[j] = (f32)(i + j) / 64.0f - 2.0f;
+        f32x8 y8 = f_sin2pi_8(x8);
+        for (u32 j = 0; j < 8; ++j) TEST(y8[j] == f_sin2pi(x8[j]));
+
+        f32x4 x4 = {x8[0], x8[3], x8[5], x8[7]};
+        f32x4 y4 = f_sin2pi_4(x4);
+        for (u32 j = 0; j < 4; ++j) TEST(y4[j] == f_sin2pi(x4[j]));
+    }
+
     u32 n = 1024;
     for (u32 i = 0; i < n; ++i) {
         f32 x = (f32)i / (f32)n * 4 - 2;
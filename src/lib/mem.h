@@ -3,14 +3,15 @@
 #pragma once
 #include "lib/types.h"
 
-// chunk_cache is a global variable
+// chunk_cache is a global variable, shared between threads
 #include "lib/global.h"
 
 // Memory can be requested from the operating system at any time.
 #include "lib/os_alloc.h"
 
-// This memory is never given back to the operating system.
+// The address space is never given back to the operating system.
 // We are managing it ourselves.
+// Only the physical memory of chunks that stay unused for a while is released (see chunk_cache_trim).
 
 // Memory is allocaed from the operating system in big fixed-size Chunks.
 // - Every chunk is the same and can be reused anywehre
@@ -32,54 +33,445 @@ struct Chunk {
     // ...
 };
 
+// ==== Thread safe chunk cache ====
+//
+// Every thread has a small private cache of free chunks.
+// Allocating and freeing is done on this cache, without any synchronization.
+//
+// When the private cache grows too big, a batch of chunks is moved to a global lock-free stack.
+// When the private cache is empty, a full batch is taken from the global stack.
+// This way the shared state is touched only once every CHUNK_BATCH_SIZE operations.
+//
+// NOTE: Chunks in a private cache are lost when the code is hot-reloaded (thread locals are reset).
+
+// Number of chunks moved between the private and the global cache at once
+#define CHUNK_BATCH_SIZE 8
+
+// A batch of free chunks on the global stack.
+// The batch header is stored inside the first chunk of the batch.
+typedef struct Chunk_Batch Chunk_Batch;
+struct Chunk_Batch {
+    // Chunks in this batch, linked by their 'next' pointer (including this one)
+    Chunk chunk;
+
+    // Next batch on the global stack
+    Chunk_Batch *next;
+
+    // Number of chunks in this batch
+    u32 count;
+
+    // Number of chunks in this batch that were given back to the operating system (see chunk_cache_trim)
+    u32 trim_count;
+};
+
+// Bytes at the start of a trimmed chunk that are never released
+#define CHUNK_TRIM_OFFSET 4096
+
+// Bytes released per trimmed chunk
+#define CHUNK_TRIM_RELEASE (CHUNK_SIZE - CHUNK_TRIM_OFFSET)
+
+// Private per-thread chunk cache
+typedef struct {
+    Chunk *first;
+    u32 count;
+} Chunk_Cache;
+
+#if OS_IS_WASM
+// Webassembly is single threaded
+static Chunk_Cache CHUNK_CACHE;
+#else
+static _Thread_local Chunk_Cache CHUNK_CACHE;
+#endif
+
+// The global stack head is a tagged pointer.
+// - The low 48 bits contain the pointer to the first batch.
+// - The high 16 bits contain a counter that is incremented on every change.
+// The counter prevents the ABA problem when a batch is popped and pushed again during a compare-exchange.
+#define CHUNK_STACK_PTR_MASK 0x0000ffffffffffffull
+#define CHUNK_STACK_TAG_ONE 0x0001000000000000ull
+
+static Chunk_Batch *chunk_stack_ptr(u64 head) {
+    return (Chunk_Batch *)(head & CHUNK_STACK_PTR_MASK);
+}
+
+// Push a batch to a global stack
+static void chunk_stack_push(u64 *stack, Chunk_Batch *batch) {
+    u64 head = __atomic_load_n(stack, __ATOMIC_ACQUIRE);
+    for (;;) {
+        batch->next = chunk_stack_ptr(head);
+        u64 new_head = (u64)batch | ((head & ~CHUNK_STACK_PTR_MASK) + CHUNK_STACK_TAG_ONE);
+        if (__atomic_compare_exchange_n(stack, &head, new_head, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) break;
+    }
+}
+
+// Pop a batch from a global stack, returns 0 if the stack is empty
+static Chunk_Batch *chunk_stack_pop(u64 *stack) {
+    u64 head = __atomic_load_n(stack, __ATOMIC_ACQUIRE);
+    for (;;) {
+        Chunk_Batch *batch = chunk_stack_ptr(head);
+        if (!batch) return 0;
+
+        // The batch might be popped and reused by another thread while we read this.
+        // This is fine, chunks are never unmapped and the tag will cause the exchange to fail.
+        Chunk_Batch *next = batch->next;
+        u64 new_head = (u64)next | ((head & ~CHUNK_STACK_PTR_MASK) + CHUNK_STACK_TAG_ONE);
+        if (__atomic_compare_exchange_n(stack, &head, new_head, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) return batch;
+    }
+}
+
+// Move 'count' chunks from the private cache to the global stack as a single batch
+static void chunk_cache_flush(Chunk_Cache *cache, u32 count) {
+    if (count > cache->count) count = cache->count;
+    if (count == 0) return;
+
+    // Split the first 'count' chunks from the list
+    Chunk *first = cache->first;
+    Chunk *last = first;
+    for (u32 i = 1; i < count; ++i) last = last->next;
+    cache->first = last->next;
+    cache->count -= count;
+    last->next = 0;
+
+    Chunk_Batch *batch = (Chunk_Batch *)first;
+    batch->count = count;
+    batch->trim_count = 0;
+    chunk_stack_push(&G->chunk_cache, batch);
+}
+
+// Give all chunks in the private cache of this thread back to the global stack.
+// Should be called by a thread before it exits.
+static void chunk_cache_release(void) {
+    chunk_cache_flush(&CHUNK_CACHE, CHUNK_CACHE.count);
+}
+
+// ==== Slabs ====
+//
+// Instead of mapping every chunk separately, chunks can be carved from big slabs.
+// A slab is backed by huge pages when possible, so the whole working set needs far fewer TLB entries.
+// When huge pages are not available the slab uses normal pages, which still reduces the number of mappings.
+// Huge page slabs are remembered, because releasing part of a huge page would split it (see chunk_trimmable).
+//
+// Slabs are opt-in (see G->chunk_pages), because their chunks are never trimmed.
+// A program that wants fewer TLB misses and never shrinks can enable them.
+
+// Number of bytes in a slab (64 chunks)
+#define CHUNK_SLAB_SIZE (64 * CHUNK_SIZE)
+
+// Get a new chunk directly from the operating system
+static Chunk *chunk_slab_alloc(void) {
+    // Slabs disabled, map every chunk separately
+    if (G->chunk_pages == OS_Pages_Normal) {
+        __atomic_fetch_add(&G->stat_map_count, 1, __ATOMIC_RELAXED);
+        return os_alloc(CHUNK_SIZE);
+    }
+
+    mutex_lock(&G->slab_mutex);
+
+    // Current slab is full, map a new one
+    if (G->slab_next == G->slab_end) {
+        // Only a limited number of huge page slabs can be remembered
+        OS_Pages pages = G->chunk_pages;
+        if (G->slab_huge_count == array_count(G->slab_huge)) pages = OS_Pages_Normal;
+
+        u8 *slab = os_alloc_huge(CHUNK_SLAB_SIZE, &pages);
+
+        // No huge pages on this platform, map the chunk separately
+        if (!slab) {
+            mutex_unlock(&G->slab_mutex);
+            __atomic_fetch_add(&G->stat_map_count, 1, __ATOMIC_RELAXED);
+            return os_alloc(CHUNK_SIZE);
+        }
+
+        G->slab_next = slab;
+        G->slab_end = slab + CHUNK_SLAB_SIZE;
+        __atomic_fetch_add(&G->stat_map_count, 1, __ATOMIC_RELAXED);
+        if (pages == OS_Pages_Huge) G->stat_huge_size += CHUNK_SLAB_SIZE;
+        if (pages == OS_Pages_Transparent) G->stat_thp_size += CHUNK_SLAB_SIZE;
+
+        // The trimming thread reads the list without the mutex
+        if (pages != OS_Pages_Normal) {
+            G->slab_huge[G->slab_huge_count] = slab;
+            __atomic_store_n(&G->slab_huge_count, G->slab_huge_count + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    Chunk *chunk = (Chunk *)G->slab_next;
+    G->slab_next += CHUNK_SIZE;
+    mutex_unlock(&G->slab_mutex);
+    return chunk;
+}
+
 // Allocate a new chunk
 static Chunk *chunk_alloc(void) {
+    Chunk_Cache *cache = &CHUNK_CACHE;
+
+    // Refill the private cache with a batch from the global stack
+    if (!cache->first) {
+        Chunk_Batch *batch = chunk_stack_pop(&G->chunk_cache);
+
+        // Prefer resident chunks, but trimmed chunks are still cheaper than new ones
+        if (!batch) {
+            batch = chunk_stack_pop(&G->chunk_trimmed);
+            if (batch) __atomic_fetch_sub(&G->stat_trim_size, (u64)batch->trim_count * CHUNK_TRIM_RELEASE, __ATOMIC_RELAXED);
+        }
+
+        if (batch) {
+            cache->first = &batch->chunk;
+            cache->count = batch->count;
+        }
+    }
+
     // Check if there are free chunks
-    if (G->chunk_cache) {
+    if (cache->first) {
         // Remove the free chunk from the cache
-        Chunk *chunk = G->chunk_cache;
-        G->chunk_cache = chunk->next;
+        Chunk *chunk = cache->first;
+        cache->first = chunk->next;
+        cache->count--;
         chunk->next = 0;
-        G->stat_cache_size -= CHUNK_SIZE;
+        __atomic_fetch_sub(&G->stat_cache_size, CHUNK_SIZE, __ATOMIC_RELAXED);
 
         // Give it to the caller
         return chunk;
     }
 
-    G->stat_alloc_size += CHUNK_SIZE;
+    __atomic_fetch_add(&G->stat_alloc_size, CHUNK_SIZE, __ATOMIC_RELAXED);
 
     // The cache is empty, ask the os for a new chunk.
-    return os_alloc(CHUNK_SIZE);
+    return chunk_slab_alloc();
 }
 
 // Free all used chunks in this list and add the to the cache
 static void chunk_free(Chunk *first) {
+    Chunk_Cache *cache = &CHUNK_CACHE;
     Chunk *chunk = first;
     while (chunk) {
         Chunk *next = chunk->next;
-        LIST_PUSH(G->chunk_cache, chunk);
-        G->stat_cache_size += CHUNK_SIZE;
+        LIST_PUSH(cache->first, chunk);
+        cache->count++;
+        __atomic_fetch_add(&G->stat_cache_size, CHUNK_SIZE, __ATOMIC_RELAXED);
         chunk = next;
     }
+
+    // Keep the private cache small, share the rest with other threads
+    while (cache->count >= CHUNK_BATCH_SIZE * 2) {
+        chunk_cache_flush(cache, CHUNK_BATCH_SIZE);
+    }
+}
+
+// ==== Cache trimming ====
+//
+// Free chunks that stay unused for a while are given back to the operating system.
+// Every CHUNK_TRIM_FRAMES frames we look at the lowest amount of resident cached memory in that period.
+// That memory was not needed at all, so anything above CHUNK_TRIM_KEEP is released.
+//
+// Only batches on the global stack are trimmed.
+// The first page of every chunk stays resident, it contains the list pointers.
+// The chunks are not unmapped, because the lock-free stack might still read a stale header.
+// Chunks in huge page slabs are skipped, releasing part of a huge page would split it into normal pages.
+
+// Number of frames between trims (about 2 seconds)
+#define CHUNK_TRIM_FRAMES 240
+
+// Always keep this much cached memory resident (high watermark)
+#define CHUNK_TRIM_KEEP (32 * CHUNK_SIZE)
+
+// Can the memory of this chunk be released without splitting a huge page?
+static bool chunk_trimmable(Chunk *chunk) {
+    u32 count = __atomic_load_n(&G->slab_huge_count, __ATOMIC_ACQUIRE);
+    for (u32 i = 0; i < count; ++i) {
+        u8 *slab = G->slab_huge[i];
+        if ((u8 *)chunk >= slab && (u8 *)chunk < slab + CHUNK_SLAB_SIZE) return false;
+    }
+    return true;
+}
+
+// Release up to 'size' bytes of cached memory to the operating system
+// Returns the number of bytes that were actually released
+static u64 chunk_cache_trim_size(u64 size) {
+    u64 trimmed = 0;
+    while (trimmed < size) {
+        Chunk_Batch *batch = chunk_stack_pop(&G->chunk_cache);
+        if (!batch) break;
+
+        u32 count = batch->count;
+        u32 trim_count = 0;
+        Chunk *chunk = &batch->chunk;
+        for (u32 i = 0; i < count; ++i) {
+            if (chunk_trimmable(chunk) && os_decommit((void *)chunk + CHUNK_TRIM_OFFSET, CHUNK_TRIM_RELEASE)) trim_count++;
+            chunk = chunk->next;
+        }
+
+        // Batches that could not be trimmed are still moved, so they are not visited again
+        batch->trim_count = trim_count;
+        chunk_stack_push(&G->chunk_trimmed, batch);
+        __atomic_fetch_add(&G->stat_trim_size, (u64)trim_count * CHUNK_TRIM_RELEASE, __ATOMIC_RELAXED);
+        trimmed += (u64)trim_count * CHUNK_TRIM_RELEASE;
+    }
+    return trimmed;
+}
+
+// Cached memory that is still backed by physical memory
+static u64 chunk_cache_resident(void) {
+    return __atomic_load_n(&G->stat_cache_size, __ATOMIC_RELAXED) - __atomic_load_n(&G->stat_trim_size, __ATOMIC_RELAXED);
+}
+
+// Trim policy, call once per frame from the main thread
+static void chunk_cache_trim(void) {
+    u64 resident = chunk_cache_resident();
+    if (G->trim_frame == 0 || resident < G->trim_low) G->trim_low = resident;
+
+    if (++G->trim_frame < CHUNK_TRIM_FRAMES) return;
+    G->trim_frame = 0;
+
+    // This memory was not used during the entire period
+    if (G->trim_low > CHUNK_TRIM_KEEP) chunk_cache_trim_size(G->trim_low - CHUNK_TRIM_KEEP);
+}
+
+// Allocations that are too big for a single chunk get their own block.
+// A block is a contiguous range of 'count' chunks, directly from the operating system.
+// When freed the block is split up into normal chunks and added to the cache.
+typedef struct Chunk_Large Chunk_Large;
+struct Chunk_Large {
+    Chunk_Large *next;
+
+    // Number of chunks in this block
+    u32 count;
+};
+
+// Size of the large block header, keeps the data 16 byte aligned
+#define CHUNK_LARGE_HEADER_SIZE 16
+static_assert(sizeof(Chunk_Large) <= CHUNK_LARGE_HEADER_SIZE);
+
+// Allocate a contiguous block that can hold at least 'size' bytes
+static Chunk_Large *chunk_large_alloc(u32 size) {
+    // Computed in 64 bit, sizes close to 4 GB would wrap around
+    u64 count = ((u64)size + CHUNK_LARGE_HEADER_SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    assert(count * CHUNK_SIZE <= U32_MAX, "Allocation is too big for a large block");
+    __atomic_fetch_add(&G->stat_alloc_size, count * CHUNK_SIZE, __ATOMIC_RELAXED);
+
+    Chunk_Large *large = os_alloc(count * CHUNK_SIZE);
+    assert(large, "Failed to allocate a large block");
+    __atomic_fetch_add(&G->stat_map_count, 1, __ATOMIC_RELAXED);
+    large->next = 0;
+    large->count = count;
+    return large;
+}
+
+// Free all large blocks in this list by splitting them into chunks
+static void chunk_large_free(Chunk_Large *first) {
+    Chunk_Large *large = first;
+    while (large) {
+        Chunk_Large *next = large->next;
+        u32 count = large->count;
+        for (u32 i = 0; i < count; ++i) {
+            Chunk *chunk = (void *)large + (u64)i * CHUNK_SIZE;
+            chunk->next = 0;
+            chunk_free(chunk);
+        }
+        large = next;
+    }
+}
+
+// Guard page allocator
+//
+// Compile with MEM_GUARD=1 (see Clang_Options.guard) to debug memory corruption.
+// Every allocation gets its own pages and is placed at the end, directly followed by an inaccessible guard page.
+// Writing past the end of an allocation crashes immediately instead of silently corrupting its neighbour.
+// Freed allocations are made inaccessible as well and their addresses are never reused, this catches use after free.
+//
+// Allocations are still 16 byte aligned, so overruns of less than 16 bytes can go unnoticed.
+// This mode uses a lot more memory and is slow, only use it for debugging.
+#ifndef MEM_GUARD
+#define MEM_GUARD 0
+#endif
+
+typedef struct Mem_Guard Mem_Guard;
+struct Mem_Guard {
+    Mem_Guard *next;
+    u32 size;
+};
+
+// Allocate 'size' bytes right before a guard page
+// The header is stored at the start of the first page.
+static Mem_Guard *mem_guard_alloc(u32 size, void **ptr) {
+    u32 data_size = size + sizeof(Mem_Guard) + 16;
+    u32 data_pages = (data_size + OS_PAGE_SIZE - 1) / OS_PAGE_SIZE;
+    u32 total_size = (data_pages + 1) * OS_PAGE_SIZE;
+
+    u8 *base = os_alloc(total_size);
+    assert(base, "Failed to allocate guarded memory");
+    __atomic_fetch_add(&G->stat_map_count, 1, __ATOMIC_RELAXED);
+
+    // Make the last page inaccessible
+    u8 *guard = base + data_pages * OS_PAGE_SIZE;
+    os_protect_none(guard, OS_PAGE_SIZE);
+
+    Mem_Guard *header = (Mem_Guard *)base;
+    header->next = 0;
+    header->size = total_size;
+    *ptr = (void *)((u64)(guard - size) & ~(u64)15);
+    return header;
+}
+
+// Free all guarded allocations in this list
+// The physical memory is released, but the address range stays inaccessible.
+static void mem_guard_free(Mem_Guard *first) {
+    Mem_Guard *guard = first;
+    while (guard) {
+        Mem_Guard *next = guard->next;
+        u32 size = guard->size;
+        os_decommit(guard, size);
+        os_protect_none(guard, size);
+        guard = next;
+    }
 }
 
 typedef struct Memory Memory;
 
 // A stack allocator for variable size allocations.
-// Each allocation should be smaller than the chunk size.
+// Allocations bigger than a chunk are placed in their own large block.
 struct Memory {
     // A list of used chunks.
     // The first entry is still being used for new allocations.
     Chunk *chunk;
 
+    // A list of large blocks, one per oversized allocation
+    Chunk_Large *large;
+
+    // A list of guarded allocations, only used when MEM_GUARD is enabled
+    Mem_Guard *guard;
+
     // Bytes used in the current chunck
     // This includes the chunk header
     u32 used;
 
     // Total size of the first chunk (always 1 MB)
     u32 size;
+
+    // Statistics
+    // Named arenas are listed in the registry (see mem_set_name)
+    char *name;
+    Memory *name_next;
+
+    // Chunks held by this arena, including large blocks
+    u32 stat_chunks;
+
+    // Number of allocations since the start of the frame (see mem_stats_frame)
+    // Reset by the main thread while the owner counts, so it is only accessed atomically.
+    u32 stat_allocs;
+
+    // Bytes currently allocated, and the highest value seen
+    u64 stat_used;
+    u64 stat_peak;
 };
 
+// Track a new allocation of 'size' bytes
+static void mem_stats_push(Memory *mem, u32 size) {
+    __atomic_fetch_add(&mem->stat_allocs, 1, __ATOMIC_RELAXED);
+    mem->stat_used += size;
+    if (mem->stat_used > mem->stat_peak) mem->stat_peak = mem->stat_used;
+}
+
 // Align the next allocation to 16 bytes
 static void u32_align(u32 *addr, u32 bytes) {
     u32 mask = bytes - 1;
@@ -99,6 +491,26 @@ static void *mem_push_uninit(Memory *mem, u32 size) {
     //
     // Assuming 16 byte alignment for all allocations
     u32 align = 16;
+
+    mem_stats_push(mem, size);
+
+    // Debug mode, every allocation gets its own guarded pages
+    if (MEM_GUARD) {
+        void *ptr;
+        Mem_Guard *guard = mem_guard_alloc(size, &ptr);
+        LIST_PUSH(mem->guard, guard);
+        return ptr;
+    }
+
+    // The allocation will never fit in a chunk, give it its own block.
+    // The current chunk is not touched, so it can still be used for small allocations.
+    if (size > CHUNK_SIZE - CHUNK_LARGE_HEADER_SIZE) {
+        Chunk_Large *large = chunk_large_alloc(size);
+        LIST_PUSH(mem->large, large);
+        mem->stat_chunks += large->count;
+        return (void *)large + CHUNK_LARGE_HEADER_SIZE;
+    }
+
     u32_align(&mem->used, align);
 
     // Check if the allocation will fit
@@ -111,6 +523,7 @@ static void *mem_push_uninit(Memory *mem, u32 size) {
         // Fhe previous chunk is now full
         chunk->next = mem->chunk;
         mem->chunk = chunk;
+        mem->stat_chunks++;
 
         // Chunks are always the same size
         mem->size = CHUNK_SIZE;
@@ -119,7 +532,7 @@ static void *mem_push_uninit(Memory *mem, u32 size) {
         // Redo the alignment
         u32_align(&mem->used, align);
 
-        // This allocation does not fit
+        // Checked above, allocations this big use a large block
         assert0(mem->used + size <= mem->size);
     }
 
@@ -161,16 +574,154 @@ static Memory *mem_new(void) {
     return mem_heap;
 }
 
+// Give this arena a name and add it to the registry of G->mem_list
+// The name should be a constant string.
+static void mem_set_name(Memory *mem, char *name) {
+    mutex_lock(&G->mem_list_mutex);
+    if (!mem->name) {
+        mem->name_next = G->mem_list;
+        G->mem_list = mem;
+    }
+    mem->name = name;
+    mutex_unlock(&G->mem_list_mutex);
+}
+
+// Remove a named arena from the registry
+static void mem_stats_remove(Memory *mem) {
+    mutex_lock(&G->mem_list_mutex);
+    for (Memory **it = &G->mem_list; *it; it = &(*it)->name_next) {
+        if (*it != mem) continue;
+        *it = mem->name_next;
+        break;
+    }
+    mutex_unlock(&G->mem_list_mutex);
+}
+
+// Start counting allocations for a new frame
+static void mem_stats_frame(void) {
+    mutex_lock(&G->mem_list_mutex);
+    for (Memory *mem = G->mem_list; mem; mem = mem->name_next) {
+        __atomic_store_n(&mem->stat_allocs, 0, __ATOMIC_RELAXED);
+    }
+    mutex_unlock(&G->mem_list_mutex);
+}
+
 // Free this memory allocator and all it's allocations
 static void mem_free(Memory *mem) {
+    if (mem->name) mem_stats_remove(mem);
+
+    // Copy the lists, the arena itself lives in its first chunk or guarded allocation
+    Chunk *chunk = mem->chunk;
+    Mem_Guard *guard = mem->guard;
+
+    // Free all large blocks first
+    chunk_large_free(mem->large);
+
     // Free all chunks in this memory arena
-    chunk_free(mem->chunk);
+    chunk_free(chunk);
+
+    // Free all guarded allocations
+    mem_guard_free(guard);
+}
+
+// A checkpoint in a memory arena, see mem_mark() and mem_rewind()
+typedef struct {
+    Chunk *chunk;
+    Chunk_Large *large;
+    Mem_Guard *guard;
+    u32 used;
+    u32 size;
+    u64 stat_used;
+} Memory_Mark;
+
+// Remember the current allocation position
+// Everything allocated after this point can be released with mem_rewind()
+static Memory_Mark mem_mark(Memory *mem) {
+    return (Memory_Mark){
+        .chunk = mem->chunk,
+        .large = mem->large,
+        .guard = mem->guard,
+        .used = mem->used,
+        .size = mem->size,
+        .stat_used = mem->stat_used,
+    };
 }
 
-// Reallocate memory and fill new space with zeros
+// Release all allocations made after 'mark'
+// Only the chunks that were added after the mark are returned to the cache.
+// Marks can be nested, but should be rewound in reverse order.
+static void mem_rewind(Memory *mem, Memory_Mark mark) {
+    // Free the large blocks added after the mark
+    while (mem->large != mark.large) {
+        Chunk_Large *large = mem->large;
+        assert(large, "Memory mark is not part of this arena");
+        mem->large = large->next;
+        mem->stat_chunks -= large->count;
+        large->next = 0;
+        chunk_large_free(large);
+    }
+
+    // Free the guarded allocations added after the mark
+    while (mem->guard != mark.guard) {
+        Mem_Guard *guard = mem->guard;
+        assert(guard, "Memory mark is not part of this arena");
+        mem->guard = guard->next;
+        guard->next = 0;
+        mem_guard_free(guard);
+    }
+
+    // Free the chunks added after the mark
+    while (mem->chunk != mark.chunk) {
+        Chunk *chunk = mem->chunk;
+        assert(chunk, "Memory mark is not part of this arena");
+        mem->chunk = chunk->next;
+        mem->stat_chunks--;
+        chunk->next = 0;
+        chunk_free(chunk);
+    }
+
+    // Continue allocating in the marked chunk
+    mem->used = mark.used;
+    mem->size = mark.size;
+    mem->stat_used = mark.stat_used;
+}
+
+// Check if 'ptr' is the most recent allocation in the current chunk
+static bool mem_is_last(Memory *mem, void *ptr, u32 size) {
+    if (!ptr || !mem->chunk) return false;
+    return (u8 *)ptr + size == (u8 *)mem->chunk + mem->used;
+}
+
+// Grow an allocation, the new space is uninitialized
+// The allocation is extended in place if it was the last one and still fits in the current chunk.
 static u8 *mem_realloc(Memory *mem, u8 *old, u32 old_size, u32 new_size) {
     assert0(old_size < new_size);
+
+    if (mem_is_last(mem, old, old_size)) {
+        u32 offset = old - (u8 *)mem->chunk;
+        if (offset + new_size <= mem->size) {
+            mem->used = offset + new_size;
+            mem->stat_used += new_size - old_size;
+            return old;
+        }
+    }
+
     u8 *new = mem_push_uninit(mem, new_size);
     std_memcpy(new, old, old_size);
     return new;
 }
+
+// Shrink an allocation
+// The freed space is only reused if it was the last allocation.
+static void mem_shrink(Memory *mem, void *ptr, u32 old_size, u32 new_size) {
+    assert0(new_size <= old_size);
+    if (!mem_is_last(mem, ptr, old_size)) return;
+    mem->used -= old_size - new_size;
+    mem->stat_used -= old_size - new_size;
+}
+
+// Free an allocation
+// The space is only reused if it was the last allocation.
+static void mem_pop(Memory *mem, void *ptr, u32 size) {
+    mem_shrink(mem, ptr, size, 0);
+}
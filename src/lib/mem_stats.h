@@ -0,0 +1,81 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// mem_stats.h - Memory usage per named arena
+#pragma once
+#include "lib/fmt.h"
+#include "lib/mem.h"
+#include "lib/test.h"
+
+// Write a single padded table column
+static void mem_stats_col_s(Fmt *fmt, char *value, u32 width) {
+    u32 cursor = fmt_cursor(fmt);
+    fmt_s(fmt, value);
+    fmt_pad(fmt, cursor, ' ', width, false);
+}
+
+static void mem_stats_col_u(Fmt *fmt, u64 value, u32 width) {
+    u32 cursor = fmt_cursor(fmt);
+    fmt_u_base(fmt, 10, value);
+    fmt_pad(fmt, cursor, ' ', width, true);
+}
+
+// Format a table with the statistics of all named arenas
+// Sizes are in KB, 'Allocs' counts the allocations in the current frame.
+static void mem_stats_fmt(Fmt *fmt) {
+    fmt_s(fmt, " Arena       Chunks   Used KB   Peak KB   Allocs\n");
+
+    mutex_lock(&G->mem_list_mutex);
+    for (Memory *mem = G->mem_list; mem; mem = mem->name_next) {
+        fmt_s(fmt, " ");
+        mem_stats_col_s(fmt, mem->name, 11);
+        mem_stats_col_u(fmt, mem->stat_chunks, 7);
+        mem_stats_col_u(fmt, mem->stat_used / 1024, 10);
+        mem_stats_col_u(fmt, mem->stat_peak / 1024, 10);
+        mem_stats_col_u(fmt, __atomic_load_n(&mem->stat_allocs, __ATOMIC_RELAXED), 9);
+        fmt_s(fmt, "\n");
+    }
+    mutex_unlock(&G->mem_list_mutex);
+}
+
+// Print the table to stdout
+static void mem_stats_print(void) {
+    mem_stats_fmt(G->fmt);
+}
+
+static void mem_stats_test(Test *test) {
+    Memory *mem = mem_new();
+    mem_set_name(mem, "test");
+    TEST(G->mem_list == mem);
+
+    // Only counts allocations after the start of the frame
+    mem_stats_frame();
+    TEST(mem->stat_allocs == 0);
+    u64 used = mem->stat_used;
+    mem_push_uninit(mem, 100);
+    mem_push_uninit(mem, 200);
+    TEST(mem->stat_allocs == 2);
+    TEST(mem->stat_used == used + 300);
+    TEST(mem->stat_chunks == 1);
+
+    // Rewinding restores the used bytes, but keeps the peak
+    Memory_Mark mark = mem_mark(mem);
+    mem_push_uninit(mem, CHUNK_SIZE / 2);
+    mem_push_uninit(mem, CHUNK_SIZE / 2);
+    mem_push_uninit(mem, CHUNK_SIZE * 2);
+    if (!MEM_GUARD) TEST(mem->stat_chunks == 2 + 3);
+    u64 peak = mem->stat_peak;
+    mem_rewind(mem, mark);
+    if (!MEM_GUARD) TEST(mem->stat_chunks == 1);
+    TEST(mem->stat_used == used + 300);
+    TEST(mem->stat_peak == peak);
+
+    // The table lists the arena
+    Fmt *fmt = fmt_memory(test->mem);
+    mem_stats_fmt(fmt);
+    String table = fmt_get(fmt);
+    String row = str_drop_start(table, str_find(table, '\n') + 1);
+    TEST(str_starts_with(row, S(" test ")));
+
+    // Freeing removes the arena from the registry
+    mem_free(mem);
+    TEST(G->mem_list != mem);
+}
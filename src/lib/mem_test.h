@@ -0,0 +1,115 @@
+#pragma once
+#include "lib/mem.h"
+#include "lib/test.h"
+
+static void mem_test(Test *test) {
+    // These tests check the chunk layout, which is not used with guard pages
+    if (MEM_GUARD) return;
+
+    Memory *mem = mem_new();
+
+    // Small allocations are placed in the current chunk
+    u8 *small = mem_push_zero(mem, 64);
+    Chunk *chunk = mem->chunk;
+    TEST(small != 0);
+    TEST(mem->large == 0);
+
+    // Allocations bigger than a chunk get their own block
+    u64 alloc_before = G->stat_alloc_size;
+    u32 large_size = CHUNK_SIZE * 3 + 123;
+    u8 *large = mem_push_uninit(mem, large_size);
+    TEST(large != 0);
+    TEST(mem->large != 0);
+    TEST(mem->large->count == 4);
+    TEST(((u64)large & 15) == 0);
+    TEST(G->stat_alloc_size - alloc_before == 4 * CHUNK_SIZE);
+
+    // The whole allocation is usable
+    large[0] = 'A';
+    large[large_size - 1] = 'Z';
+    TEST(large[0] == 'A');
+    TEST(large[large_size - 1] == 'Z');
+
+    // The current chunk is not affected
+    TEST(mem->chunk == chunk);
+    u8 *small2 = mem_push_uninit(mem, 64);
+    TEST(small2 == small + 64);
+
+    // Zero initialized large allocations
+    u8 *zero = mem_push_zero(mem, CHUNK_SIZE);
+    TEST(zero[0] == 0 && zero[CHUNK_SIZE - 1] == 0);
+    TEST(mem->large->count == 2);
+
+    // Rewinding releases everything allocated after the mark
+    Memory_Mark mark = mem_mark(mem);
+    u8 *scratch = mem_push_uninit(mem, 64);
+    TEST(scratch == small2 + 64);
+    for (u32 i = 0; i < 3; ++i) mem_push_uninit(mem, CHUNK_SIZE / 2);
+    mem_push_uninit(mem, CHUNK_SIZE * 2);
+    TEST(mem->chunk != chunk);
+    mem_rewind(mem, mark);
+    TEST(mem->chunk == chunk);
+    TEST(mem->large->count == 2);
+    TEST(mem_push_uninit(mem, 64) == scratch);
+
+    // Marks can be nested
+    Memory_Mark outer = mem_mark(mem);
+    mem_push_uninit(mem, CHUNK_SIZE / 2);
+    mem_push_uninit(mem, CHUNK_SIZE / 2);
+    Chunk *chunk_outer = mem->chunk;
+    Memory_Mark inner = mem_mark(mem);
+    mem_push_uninit(mem, CHUNK_SIZE / 2);
+    mem_push_uninit(mem, CHUNK_SIZE / 2);
+    TEST(mem->chunk != chunk_outer);
+    mem_rewind(mem, inner);
+    TEST(mem->chunk == chunk_outer);
+    mem_rewind(mem, outer);
+    TEST(mem->chunk == chunk);
+
+    // The last allocation grows in place
+    u8 *buf = mem_push_uninit(mem, 16);
+    std_memcpy(buf, "0123456789abcdef", 16);
+    TEST(mem_realloc(mem, buf, 16, 64) == buf);
+    TEST(mem_realloc(mem, buf, 64, 1024) == buf);
+    TEST(buf[15] == 'f');
+    TEST(mem_push_uninit(mem, 16) == buf + 1024);
+
+    // Other allocations are copied
+    u8 *moved = mem_realloc(mem, buf, 1024, 2048);
+    TEST(moved != buf);
+    TEST(moved[0] == '0' && moved[15] == 'f');
+
+    // Growing past the end of the chunk moves to a new chunk
+    u8 *big = mem_realloc(mem, moved, 2048, CHUNK_SIZE / 2);
+    big = mem_realloc(mem, big, CHUNK_SIZE / 2, CHUNK_SIZE - 1024);
+    TEST(mem->chunk != chunk);
+    TEST(big[0] == '0' && big[15] == 'f');
+    TEST(mem_realloc(mem, big, CHUNK_SIZE - 1024, CHUNK_SIZE - 512) == big);
+
+    // Shrinking and popping the last allocation makes space available again
+    mem_shrink(mem, big, CHUNK_SIZE - 512, 64);
+    TEST(mem_push_uninit(mem, 64) == big + 64);
+    u8 *top = mem_push_uninit(mem, 32);
+    mem_pop(mem, top, 32);
+    TEST(mem_push_uninit(mem, 32) == top);
+
+    // Popping something that is not the last allocation does nothing
+    u32 used = mem->used;
+    mem_pop(mem, big, 64);
+    TEST(mem->used == used);
+
+    // Guarded allocations end right before the guard page
+    void *guarded = 0;
+    Mem_Guard *guard = mem_guard_alloc(100, &guarded);
+    u64 guard_end = ((u64)guarded + 100 + OS_PAGE_SIZE - 1) & ~(u64)(OS_PAGE_SIZE - 1);
+    TEST(((u64)guarded & 15) == 0);
+    TEST(guard_end - ((u64)guarded + 100) < 16);
+    TEST(guard->size == 2 * OS_PAGE_SIZE);
+    std_memzero(guarded, 100);
+    mem_guard_free(guard);
+
+    // Freeing returns every chunk of the large blocks to the cache
+    u64 cache_before = G->stat_cache_size;
+    mem_free(mem);
+    TEST(G->stat_cache_size - cache_before == 8 * CHUNK_SIZE);
+}
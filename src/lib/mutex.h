@@ -1,23 +1,101 @@
 // Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
 // mutex.h
 #pragma once
+#include "lib/os_api.h"
 #include "lib/types.h"
 
 // References:
 // - [Atomic break down: understanding ordering - Ciara](https://www.youtube.com/watch?v=C5xY96i0Aes)
 // - https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html
+// - [Futexes Are Tricky - Ulrich Drepper](https://www.akkadia.org/drepper/futex.pdf)
+
+// The lock spins for a short while, most locks are only held for a few instructions.
+// If the lock is still taken, the thread goes to sleep until the owner unlocks it.
+// - Linux: sleeps with FUTEX_WAIT and is woken with FUTEX_WAKE
+// - Windows: sleeps with WaitOnAddress and is woken with WakeByAddressSingle (links with synchronization.lib)
+// - Webassembly: only spins
+#define MUTEX_SPIN_COUNT 128
+
+// Lock states
+#define MUTEX_UNLOCKED 0
+#define MUTEX_LOCKED 1
+#define MUTEX_CONTENDED 2 // Locked, and there might be threads sleeping
+
 typedef struct {
-    volatile u64 lock;
+    volatile u32 state;
+
+    // Contention statistics, only modified while the lock is held
+    u64 stat_acquire; // Number of times the lock was taken
+    u64 stat_spin;    // Number of spin iterations waiting for the lock
+    u64 stat_sleep;   // Number of times a thread went to sleep waiting for the lock
+    u64 stat_hold;    // Total cycles the lock was held
+    u64 hold_start;
 } Mutex;
 
+// Cpu cycle counter, used for the hold time
+static u64 mutex_cycles(void) {
+#if OS_IS_WASM
+    return 0;
+#else
+    return __builtin_ia32_rdtsc();
+#endif
+}
+
+static void mutex_sleep(Mutex *mutex) {
+#if OS_IS_LINUX
+    linux_futex(&mutex->state, FUTEX_WAIT_PRIVATE, MUTEX_CONTENDED, 0);
+#elif OS_IS_WINDOWS
+    u32 contended = MUTEX_CONTENDED;
+    WaitOnAddress(&mutex->state, &contended, sizeof(contended), INFINITE);
+#endif
+}
+
+static void mutex_wake(Mutex *mutex) {
+#if OS_IS_LINUX
+    linux_futex(&mutex->state, FUTEX_WAKE_PRIVATE, 1, 0);
+#elif OS_IS_WINDOWS
+    WakeByAddressSingle((void *)&mutex->state);
+#endif
+}
+
 static void mutex_lock(Mutex *mutex) {
-    while (__atomic_exchange_n(&mutex->lock, 1, __ATOMIC_ACQUIRE)) {
+    u32 state = MUTEX_UNLOCKED;
+    u32 spin = 0;
+    u32 sleep = 0;
+
+    // Fast path, the lock is free
+    if (!__atomic_compare_exchange_n(&mutex->state, &state, MUTEX_LOCKED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        // Spin for a short while, without writing to the lock
+        for (; spin < MUTEX_SPIN_COUNT; ++spin) {
 #if !OS_IS_WASM
-        __asm__ __volatile__("pause");
+            __asm__ __volatile__("pause");
 #endif
+            state = __atomic_load_n(&mutex->state, __ATOMIC_RELAXED);
+            if (state != MUTEX_UNLOCKED) continue;
+            if (__atomic_compare_exchange_n(&mutex->state, &state, MUTEX_LOCKED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+        }
+
+        // Still locked, mark the lock as contended and sleep until it is released.
+        // We can't know if there are more sleepers, so we always take it as contended.
+        if (spin == MUTEX_SPIN_COUNT) {
+            while (__atomic_exchange_n(&mutex->state, MUTEX_CONTENDED, __ATOMIC_ACQUIRE) != MUTEX_UNLOCKED) {
+                mutex_sleep(mutex);
+                sleep++;
+            }
+        }
     }
+
+    mutex->hold_start = mutex_cycles();
+    mutex->stat_acquire++;
+    mutex->stat_spin += spin;
+    mutex->stat_sleep += sleep;
 }
 
 static void mutex_unlock(Mutex *mutex) {
-    __atomic_store_n(&mutex->lock, 0, __ATOMIC_RELEASE);
+    mutex->stat_hold += mutex_cycles() - mutex->hold_start;
+
+    // Only make the system call if someone might be sleeping
+    if (__atomic_exchange_n(&mutex->state, MUTEX_UNLOCKED, __ATOMIC_RELEASE) == MUTEX_CONTENDED) {
+        mutex_wake(mutex);
+    }
 }
@@ -0,0 +1,44 @@
+#pragma once
+#include "lib/job.h"
+#include "lib/mutex.h"
+#include "lib/test.h"
+
+typedef struct {
+    Mutex mutex;
+    u32 counter;
+} Mutex_Test;
+
+static void mutex_test_add(void *data, u32 index) {
+    Mutex_Test *t = data;
+    mutex_lock(&t->mutex);
+    // Non atomic read-modify-write, only correct if the lock works
+    u32 value = t->counter;
+    if (index % 64 == 0) {
+        for (u32 i = 0; i < 1000; ++i) __asm__ __volatile__("" ::: "memory");
+    }
+    t->counter = value + 1;
+    mutex_unlock(&t->mutex);
+}
+
+static void mutex_test(Test *test) {
+    Mutex_Test *t = mem_struct(test->mem, Mutex_Test);
+
+    // Uncontended
+    mutex_lock(&t->mutex);
+    TEST(t->mutex.state == MUTEX_LOCKED);
+    mutex_unlock(&t->mutex);
+    TEST(t->mutex.state == MUTEX_UNLOCKED);
+    TEST(t->mutex.stat_acquire == 1);
+    TEST(t->mutex.stat_spin == 0);
+    TEST(t->mutex.stat_sleep == 0);
+
+    // Contended by all workers
+    job_init(4);
+    u32 count = 100 * 1000;
+    Job_Group group = {};
+    job_for(&group, count, 1, mutex_test_add, t);
+    job_wait(&group);
+    TEST(t->counter == count);
+    TEST(t->mutex.stat_acquire == count + 1);
+    TEST(t->mutex.state == MUTEX_UNLOCKED);
+}
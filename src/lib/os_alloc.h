@@ -9,6 +9,39 @@
 // Allocate memory from the system
 static void *os_alloc(u32 size);
 
+// Kind of pages backing a memory region
+typedef enum {
+    // Normal 4 KB pages
+    OS_Pages_Normal,
+
+    // Transparent huge pages, the kernel tries to use 2 MB pages when possible
+    OS_Pages_Transparent,
+
+    // Explicit huge pages (reserved by the system administrator)
+    OS_Pages_Huge,
+} OS_Pages;
+
+#define OS_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Allocate a big region of memory, using at most 'pages' type of pages.
+// Huge page regions are aligned to OS_HUGE_PAGE_SIZE.
+// Falls back to smaller pages when huge pages are not available.
+// The type of pages that is actually used is returned in 'pages'.
+// Returns 0 on platforms without huge pages, there the caller should use os_alloc for smaller regions instead.
+static void *os_alloc_huge(u32 size, OS_Pages *pages);
+
+// Give the physical memory of a page aligned range back to the system.
+// The range stays valid and can be used again, but the contents are lost.
+// Returns false if the memory could not be released.
+static bool os_decommit(void *addr, u32 size);
+
+// Size of a single page of memory
+#define OS_PAGE_SIZE 4096
+
+// Make a page aligned range inaccessible, any access will crash the program.
+// Used by the guard page allocator to catch out of bounds accesses.
+static void os_protect_none(void *addr, u32 size);
+
 // Kill the current process with an error message
 static void os_fail(char *message);
 
@@ -25,6 +25,42 @@ static void *os_alloc(u32 size) {
     return ret;
 }
 
+// Try explicit huge pages first, then transparent huge pages
+static void *os_alloc_huge(u32 size, OS_Pages *pages) {
+    // Explicit huge pages, these fail when no pages are reserved (/proc/sys/vm/nr_hugepages)
+    if (*pages == OS_Pages_Huge) {
+        void *ret = linux_mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ret != MAP_FAILED) return ret;
+        *pages = OS_Pages_Transparent;
+    }
+
+    // Over-allocate, so we can align the region to a huge page boundary
+    u64 align = OS_HUGE_PAGE_SIZE;
+    u8 *base = linux_mmap(0, size + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return 0;
+
+    // Unmap the unaligned head and the tail
+    u8 *ret = (u8 *)(((u64)base + align - 1) & ~(align - 1));
+    if (ret > base) linux_munmap(base, ret - base);
+    if (base + align > ret) linux_munmap(ret + size, base + align - ret);
+
+    // Ask the kernel to back this region with huge pages
+    // This is only a hint, and fails if transparent huge pages are disabled
+    if (*pages == OS_Pages_Transparent && linux_madvise(ret, size, MADV_HUGEPAGE) != 0) {
+        *pages = OS_Pages_Normal;
+    }
+    return ret;
+}
+
+// The pages are zero filled again when they are touched
+static bool os_decommit(void *addr, u32 size) {
+    return linux_madvise(addr, size, MADV_DONTNEED) == 0;
+}
+
+static void os_protect_none(void *addr, u32 size) {
+    linux_mprotect(addr, size, PROT_NONE);
+}
+
 static void linux_puts(char *str) {
     linux_write(1, str, str_len(str));
 }
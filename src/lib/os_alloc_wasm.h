@@ -17,6 +17,21 @@ static void *os_alloc(u32 size) {
     return (void *)addr;
 }
 
+// Webassembly has no huge pages, and a big region would grow the heap at once
+static void *os_alloc_huge(u32 size, OS_Pages *pages) {
+    *pages = OS_Pages_Normal;
+    return 0;
+}
+
+// Webassembly memory can only grow, nothing is released
+static bool os_decommit(void *addr, u32 size) {
+    return false;
+}
+
+// Webassembly has no memory protection, guard pages are just normal memory
+static void os_protect_none(void *addr, u32 size) {
+}
+
 WASM_IMPORT(wasm_fail) void wasm_fail(char *message, u32 len);
 static void os_fail(char *message) {
     wasm_fail(message, str_len(message));
@@ -17,6 +17,23 @@ static void *os_alloc(u32 size) {
     );
 }
 
+// Large pages require the SeLockMemoryPrivilege, so we never use them.
+// os_alloc commits all memory at once, so a big region of normal pages would only waste memory.
+static void *os_alloc_huge(u32 size, OS_Pages *pages) {
+    *pages = OS_Pages_Normal;
+    return 0;
+}
+
+// The pages are discarded, but stay committed
+static bool os_decommit(void *addr, u32 size) {
+    return VirtualAlloc(addr, size, MEM_RESET, PAGE_READWRITE) != 0;
+}
+
+static void os_protect_none(void *addr, u32 size) {
+    DWORD old_protect;
+    VirtualProtect(addr, size, PAGE_NOACCESS, &old_protect);
+}
+
 static void os_fail(char *message) {
     MessageBox(NULL, message, "Error", MB_ICONERROR | MB_OK);
 }
@@ -37,6 +37,9 @@ extern void *dlopen(const char *file, i32 mode);
 extern void *dlsym(void *restrict handle, const char *restrict name);
 extern char *dlerror(void);
 
+// Threads are created with libc, so that thread locals and libc functions work in every thread
+extern i32 pthread_create(u64 *thread, void *attr, void *(*start_routine)(void *), void *arg);
+
 // =================== Syscalls ==============
 
 static i64 linux_syscall6(i64 a0, i64 a1, i64 a2, i64 a3, i64 a4, i64 a5, i64 a6) {
@@ -191,17 +194,48 @@ static i64 linux_getrandom(void *buf, u64 size, u32 flags) {
     return linux_syscall3(0x13e, (i64)buf, size, flags);
 }
 
+#define PROT_NONE 0x0
 #define PROT_READ 0x1
 #define PROT_WRITE 0x2
 
 #define MAP_PRIVATE 0x02
 #define MAP_ANONYMOUS 0x20
+#define MAP_NORESERVE 0x04000
+#define MAP_HUGETLB 0x40000
 #define MAP_FAILED ((void *)-1)
 
 static void *linux_mmap(void *addr, u64 len, i32 prot, i32 flags, i32 fd, i64 offset) {
     return (void *)linux_syscall6(0x09, (i64)addr, len, prot, flags, fd, offset);
 }
 
+static i32 linux_mprotect(void *addr, u64 len, i32 prot) {
+    return linux_syscall3(0x0a, (i64)addr, len, prot);
+}
+
+static i32 linux_munmap(void *addr, u64 len) {
+    return linux_syscall2(0x0b, (i64)addr, len);
+}
+
+#define MADV_DONTNEED 4
+#define MADV_HUGEPAGE 14
+
+static i32 linux_madvise(void *addr, u64 len, i32 advice) {
+    return linux_syscall3(0x1c, (i64)addr, len, advice);
+}
+
+#define FUTEX_WAIT_PRIVATE 128
+#define FUTEX_WAKE_PRIVATE 129
+
+// Sleep while '*addr == value', or wake up 'value' threads sleeping on 'addr'
+static i32 linux_futex(volatile u32 *addr, i32 op, u32 value, struct linux_timespec *timeout) {
+    return linux_syscall4(0xca, (i64)addr, op, value, (i64)timeout);
+}
+
+// Get the set of cpus this thread may run on, returns the size of the mask in bytes
+static i32 linux_sched_getaffinity(i32 pid, u64 size, u64 *mask) {
+    return linux_syscall3(0xcc, pid, size, (i64)mask);
+}
+
 #define CLOCK_MONOTONIC 1
 static i32 linux_clock_gettime(i32 clock_id, struct linux_timespec *time) {
     return linux_syscall2(0xe4, clock_id, (i64)time);
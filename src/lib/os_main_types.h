@@ -24,7 +24,12 @@ static Global GLOBAL_IMPL;
 static void global_init(File *stdout, u64 seed, u32 argc, char **argv) {
     G = &GLOBAL_IMPL;
 
+    // Map every chunk separately, so unused chunks can be trimmed (see chunk_trimmable).
+    // Set to OS_Pages_Transparent or OS_Pages_Huge to carve chunks from huge page slabs instead.
+    G->chunk_pages = OS_Pages_Normal;
+
     Memory *mem = mem_new();
+    mem_set_name(mem, "global");
     G->mem = mem;
     G->fmt = fmt_new(mem, stdout);
     G->rand = rand_alloc(mem, seed);
@@ -55,11 +60,14 @@ static u64 time_update(u64 *time, u32 *frame_skips, f32 dt) {
 }
 
 static void global_begin(void) {
+    mem_stats_frame();
     G->tmp = mem_new();
+    mem_set_name(G->tmp, "tmp");
 }
 
 static u64 global_end(void) {
     mem_free(G->tmp);
     G->tmp = 0;
+    chunk_cache_trim();
     return time_update(&G->time, &G->frame_skips, G->dt);
 }
@@ -0,0 +1,178 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// pool.h - Fixed size object pool
+#pragma once
+#include "lib/mem.h"
+#include "lib/test.h"
+#include "lib/types.h"
+
+// A pool hands out slots of a single fixed size.
+// - Slots are cache-line aligned and allocated contiguously in big blocks.
+// - Freed slots are reused by the next allocation.
+// - Clearing the pool keeps the blocks, so a pool can be reused every frame without new allocations.
+
+// Every slot is aligned to a cache line
+#define POOL_ALIGN 64
+
+// Size of a single block of slots
+#define POOL_BLOCK_SIZE (64 * 1024)
+
+typedef struct Pool_Block Pool_Block;
+typedef struct Pool_Free Pool_Free;
+
+// Header at the start of each block, the slots follow after POOL_ALIGN bytes
+struct Pool_Block {
+    Pool_Block *next;
+};
+
+// A free slot contains a pointer to the next free slot
+struct Pool_Free {
+    Pool_Free *next;
+};
+
+typedef struct {
+    // Blocks are allocated from this memory
+    Memory *mem;
+
+    // Slot size rounded up to POOL_ALIGN
+    u32 slot_size;
+
+    // Number of slots in every block
+    u32 block_slots;
+
+    // All blocks, in allocation order
+    Pool_Block *block_first;
+
+    // Block that is currently being filled, and the number of slots used in it
+    Pool_Block *block;
+    u32 block_used;
+
+    // Slots given back with pool_free
+    Pool_Free *free;
+
+    // Number of slots in use
+    u32 count;
+} Pool;
+
+// Create a pool for objects of 'size' bytes
+static Pool pool_new(Memory *mem, u32 size) {
+    u32 slot_size = size;
+    u32_align(&slot_size, POOL_ALIGN);
+
+    u32 block_slots = (POOL_BLOCK_SIZE - POOL_ALIGN) / slot_size;
+    if (block_slots == 0) block_slots = 1;
+
+    return (Pool){
+        .mem = mem,
+        .slot_size = slot_size,
+        .block_slots = block_slots,
+    };
+}
+
+// Create a pool for a specific type
+#define pool_for(mem, type) pool_new((mem), sizeof(type))
+
+static u8 *pool_block_slots(Pool_Block *block) {
+    return (u8 *)block + POOL_ALIGN;
+}
+
+// Allocate a new block and align it to a cache line
+static Pool_Block *pool_block_new(Pool *pool) {
+    u32 size = POOL_ALIGN + pool->block_slots * pool->slot_size;
+    u64 addr = (u64)mem_push_uninit(pool->mem, size + POOL_ALIGN - 1);
+    addr = (addr + POOL_ALIGN - 1) & ~(u64)(POOL_ALIGN - 1);
+    Pool_Block *block = (Pool_Block *)addr;
+    block->next = 0;
+    return block;
+}
+
+// Allocate a zero initialized slot
+static void *pool_alloc(Pool *pool) {
+    void *ptr = 0;
+    if (pool->free) {
+        // Reuse a freed slot
+        ptr = pool->free;
+        pool->free = pool->free->next;
+    } else {
+        // Current block is full, continue with the next one
+        if (!pool->block || pool->block_used == pool->block_slots) {
+            Pool_Block *next = pool->block ? pool->block->next : pool->block_first;
+
+            // No more blocks, create a new one
+            if (!next) {
+                next = pool_block_new(pool);
+                if (pool->block) {
+                    pool->block->next = next;
+                } else {
+                    pool->block_first = next;
+                }
+            }
+
+            pool->block = next;
+            pool->block_used = 0;
+        }
+
+        ptr = pool_block_slots(pool->block) + pool->block_used * pool->slot_size;
+        pool->block_used++;
+    }
+
+    pool->count++;
+    std_memzero(ptr, pool->slot_size);
+    return ptr;
+}
+
+// Give a slot back to the pool
+static void pool_free(Pool *pool, void *ptr) {
+    if (!ptr) return;
+    Pool_Free *slot = ptr;
+    slot->next = pool->free;
+    pool->free = slot;
+    pool->count--;
+}
+
+// Free all slots at once, but keep the blocks for reuse
+static void pool_clear(Pool *pool) {
+    pool->block = 0;
+    pool->block_used = 0;
+    pool->free = 0;
+    pool->count = 0;
+}
+
+#define pool_struct(pool, type) ((type *)pool_alloc(pool))
+
+static void pool_test(Test *test) {
+    Pool pool = pool_new(test->mem, 40);
+    TEST(pool.slot_size == 64);
+
+    // Slots are aligned and contiguous
+    u8 *a = pool_alloc(&pool);
+    u8 *b = pool_alloc(&pool);
+    TEST(((u64)a & (POOL_ALIGN - 1)) == 0);
+    TEST(b == a + 64);
+    TEST(pool.count == 2);
+
+    // Freed slots are reused first
+    pool_free(&pool, a);
+    TEST(pool.count == 1);
+    TEST(pool_alloc(&pool) == a);
+
+    // Fill more than one block
+    u32 total = pool.block_slots * 2 + 1;
+    for (u32 i = 2; i < total; ++i) pool_alloc(&pool);
+    TEST(pool.count == total);
+    TEST(pool.block_first->next != 0);
+
+    // Clearing reuses the same blocks in the same order
+    u64 alloc_size = G->stat_alloc_size;
+    pool_clear(&pool);
+    TEST(pool_alloc(&pool) == a);
+    TEST(pool_alloc(&pool) == b);
+    for (u32 i = 2; i < total; ++i) pool_alloc(&pool);
+    TEST(G->stat_alloc_size == alloc_size);
+
+    // Memory is zero initialized
+    u8 *c = pool_alloc(&pool);
+    c[63] = 1;
+    pool_free(&pool, c);
+    TEST(pool_alloc(&pool) == c);
+    TEST(c[63] == 0);
+}
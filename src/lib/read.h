@@ -26,7 +26,7 @@ static String read_buf(String *read, u32 len) {
     if (len > read->len) len = read->len;
     if (len == 0) return S0;
 
-    String left = {len, read->data};
+    String left = {.len = len, .data = read->data};
     read->data += len;
     read->len -= len;
     return left;
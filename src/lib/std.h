@@ -34,27 +34,89 @@
         }                                                                                                                                            \
     } while (0)
 
+// Memory functions operate on whole SIMD registers at a time
+// - AVX2 (32 bytes) when compiling with -march=x86-64-v3 or a native AVX2 cpu
+// - SSE2 (16 bytes) on other x86-64 cpus
+// - simd128 (16 bytes) on wasm
+//
+// The remaining tail is handled by a single overlapping register access at the end.
+// Only sizes smaller than one register fall back to a byte loop.
+#if __AVX2__
+#define STD_VEC_SIZE 32
+#else
+#define STD_VEC_SIZE 16
+#endif
+
+// Unaligned register sized vectors, may alias any other type
+typedef u8 Std_Vec __attribute__((vector_size(STD_VEC_SIZE), aligned(1), may_alias));
+typedef u64 Std_Vec64 __attribute__((vector_size(STD_VEC_SIZE), aligned(1), may_alias));
+
+#define STD_VEC(ptr) (*(Std_Vec *)(ptr))
+
 static void std_memcpy(u8 *restrict dst, const u8 *restrict src, u32 size) {
-    while (size--) *dst++ = *src++;
+    if (size < STD_VEC_SIZE) {
+        while (size--) *dst++ = *src++;
+        return;
+    }
+
+    Std_Vec last = STD_VEC(src + size - STD_VEC_SIZE);
+    for (u32 i = 0; i + STD_VEC_SIZE <= size; i += STD_VEC_SIZE) {
+        STD_VEC(dst + i) = STD_VEC(src + i);
+    }
+    STD_VEC(dst + size - STD_VEC_SIZE) = last;
 }
 
 static void std_memmove(u8 *dst, const u8 *src, u32 size) {
     while (size--) *dst++ = *src++;
 }
 
+static void std_memset(u8 *dst, u8 value, u32 size) {
+    if (size < STD_VEC_SIZE) {
+        while (size--) *dst++ = value;
+        return;
+    }
+
+    Std_Vec v = (Std_Vec){} + value;
+    for (u32 i = 0; i + STD_VEC_SIZE <= size; i += STD_VEC_SIZE) {
+        STD_VEC(dst + i) = v;
+    }
+    STD_VEC(dst + size - STD_VEC_SIZE) = v;
+}
+
 static void std_memzero(u8 *dst, u32 size) {
-    while (size--) *dst++ = 0;
+    std_memset(dst, 0, size);
 }
 
-static void std_memset(u8 *dst, u8 value, u32 size) {
-    while (size--) *dst++ = value;
+// Check if two vectors are different
+static bool std_vec_ne(Std_Vec a, Std_Vec b) {
+    Std_Vec64 diff = (Std_Vec64)(a ^ b);
+    u64 any = 0;
+    for (u32 i = 0; i < STD_VEC_SIZE / 8; ++i) any |= diff[i];
+    return any != 0;
 }
 
 static bool std_memcmp(const u8 *restrict a, const u8 *restrict b, u32 size) {
-    while (size--) {
-        if (*a++ != *b++) return false;
+    if (size < STD_VEC_SIZE) {
+        while (size--) {
+            if (*a++ != *b++) return false;
+        }
+        return true;
+    }
+
+    // Reduce 4 registers at a time, checking the result is the slowest part
+    u32 i = 0;
+    for (; i + 4 * STD_VEC_SIZE <= size; i += 4 * STD_VEC_SIZE) {
+        Std_Vec d0 = STD_VEC(a + i + 0 * STD_VEC_SIZE) ^ STD_VEC(b + i + 0 * STD_VEC_SIZE);
+        Std_Vec d1 = STD_VEC(a + i + 1 * STD_VEC_SIZE) ^ STD_VEC(b + i + 1 * STD_VEC_SIZE);
+        Std_Vec d2 = STD_VEC(a + i + 2 * STD_VEC_SIZE) ^ STD_VEC(b + i + 2 * STD_VEC_SIZE);
+        Std_Vec d3 = STD_VEC(a + i + 3 * STD_VEC_SIZE) ^ STD_VEC(b + i + 3 * STD_VEC_SIZE);
+        if (std_vec_ne((d0 | d1) | (d2 | d3), (Std_Vec){})) return false;
+    }
+
+    for (; i + STD_VEC_SIZE <= size; i += STD_VEC_SIZE) {
+        if (std_vec_ne(STD_VEC(a + i), STD_VEC(b + i))) return false;
     }
-    return true;
+    return !std_vec_ne(STD_VEC(a + size - STD_VEC_SIZE), STD_VEC(b + size - STD_VEC_SIZE));
 }
 
 static void std_reverse(u8 *buf, u32 size) {
@@ -68,5 +130,5 @@ static void std_reverse(u8 *buf, u32 size) {
 // Return number of bytes needed to achive the alignment
 static u32 std_align_offset(void *ptr, u32 align) {
     u32 mask = align - 1;
-    return ((u64)ptr + mask) & mask - (u64)ptr;
+    return (align - ((u64)ptr & mask)) & mask;
 }
@@ -0,0 +1,86 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// std_bench.c - Compare the SIMD memory functions against the old loops from std.h
+//
+// Run with: ./build build src/lib/std_bench.c out/std_bench --release && out/std_bench
+#include "lib/fmt.h"
+#include "lib/os_main.h"
+#include "lib/std.h"
+
+// The implementations from before vectorization, exactly as they were in std.h.
+// The compiler may still vectorize them, just like it did for the real ones.
+// 'noinline' only keeps the calls separate, so they can not be merged with the benchmark loop.
+__attribute__((noinline)) static void bench_memcpy_byte(u8 *restrict dst, const u8 *restrict src, u32 size) {
+    while (size--) *dst++ = *src++;
+}
+
+__attribute__((noinline)) static void bench_memset_byte(u8 *dst, u8 value, u32 size) {
+    while (size--) *dst++ = value;
+}
+
+__attribute__((noinline)) static bool bench_memcmp_byte(const u8 *restrict a, const u8 *restrict b, u32 size) {
+    while (size--) {
+        if (*a++ != *b++) return false;
+    }
+    return true;
+}
+
+typedef enum {
+    Bench_Copy,
+    Bench_Set,
+    Bench_Cmp,
+} Bench_Op;
+
+// Run one operation on 'size' bytes until about 256 MB are processed, returns throughput in GB/s
+static f32 bench_run(Bench_Op op, bool simd, u8 *dst, u8 *src, u32 size) {
+    u32 count = (256 * 1024 * 1024) / size;
+    u32 result = 0;
+
+    // Equal buffers, so memcmp has to look at every byte
+    if (op == Bench_Cmp) std_memcpy(dst, src, size);
+
+    u64 t0 = os_time();
+    for (u32 i = 0; i < count; ++i) {
+        if (op == Bench_Copy && simd) std_memcpy(dst, src, size);
+        if (op == Bench_Copy && !simd) bench_memcpy_byte(dst, src, size);
+        if (op == Bench_Set && simd) std_memset(dst, i, size);
+        if (op == Bench_Set && !simd) bench_memset_byte(dst, i, size);
+        if (op == Bench_Cmp && simd) result += std_memcmp(dst, src, size);
+        if (op == Bench_Cmp && !simd) result += bench_memcmp_byte(dst, src, size);
+
+        // Prevent the compiler from moving the operation out of the loop or past the timer
+        __asm__ __volatile__("" : "+r"(dst), "+r"(src), "+r"(result) : : "memory");
+    }
+    u64 t1 = os_time();
+
+    f32 seconds = (f32)(t1 - t0) / 1e6f;
+    if (seconds <= 0) seconds = 1e-6f;
+    return (f32)count * size / seconds / 1e9f;
+}
+
+static void os_main(void) {
+    u32 max_size = 1024 * 1024;
+    u8 *src = mem_push_uninit(G->tmp, max_size);
+    u8 *dst = mem_push_uninit(G->tmp, max_size);
+    for (u32 i = 0; i < max_size; ++i) src[i] = dst[i] = i;
+
+    char *names[] = {"memcpy", "memset", "memcmp"};
+    u32 sizes[] = {8, 16, 33, 64, 256, 4 * 1024, 64 * 1024, 1024 * 1024};
+
+    fmt_su(G->fmt, "Register size: ", STD_VEC_SIZE, " bytes\n");
+    fmt_s(G->fmt, "Throughput in GB/s, old loop -> simd\n");
+    for (u32 op = 0; op < array_count(names); ++op) {
+        fmt_ss(G->fmt, "\n", names[op], "\n");
+        for (u32 i = 0; i < array_count(sizes); ++i) {
+            u32 size = sizes[i];
+            f32 byte = bench_run(op, false, dst, src, size);
+            f32 simd = bench_run(op, true, dst, src, size);
+            fmt_su(G->fmt, "  ", size, " bytes: ");
+            fmt_f(G->fmt, byte);
+            fmt_s(G->fmt, " -> ");
+            fmt_f(G->fmt, simd);
+            fmt_sf(G->fmt, " (", simd / byte, "x)\n");
+        }
+    }
+    fmt_flush(G->fmt);
+    os_exit(0);
+}
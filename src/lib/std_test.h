@@ -0,0 +1,56 @@
+#pragma once
+#include "lib/std.h"
+#include "lib/test.h"
+
+// Check all sizes around the register width and unaligned pointers
+static void std_test(Test *test) {
+    u8 src[256];
+    u8 dst[256];
+    for (u32 i = 0; i < sizeof(src); ++i) src[i] = i * 7 + 1;
+
+    bool copy_ok = true;
+    bool set_ok = true;
+    bool zero_ok = true;
+    bool cmp_ok = true;
+    for (u32 offset = 0; offset < 4; ++offset) {
+        for (u32 size = 0; size <= 5 * STD_VEC_SIZE + 1; ++size) {
+            u8 *d = dst + offset;
+            u8 *s = src + 3 - offset;
+
+            // Copy, nothing outside the range is touched
+            for (u32 i = 0; i < sizeof(dst); ++i) dst[i] = 0xaa;
+            std_memcpy(d, s, size);
+            for (u32 i = 0; i < size; ++i) copy_ok &= d[i] == s[i];
+            copy_ok &= dst[offset + size] == 0xaa;
+            if (offset > 0) copy_ok &= dst[offset - 1] == 0xaa;
+
+            // Compare, a difference in any position is detected
+            cmp_ok &= std_memcmp(d, s, size);
+            for (u32 i = 0; i < size; ++i) {
+                d[i] ^= 1;
+                cmp_ok &= !std_memcmp(d, s, size);
+                d[i] ^= 1;
+            }
+
+            // Set and zero
+            std_memset(d, 0x55, size);
+            for (u32 i = 0; i < size; ++i) set_ok &= d[i] == 0x55;
+            set_ok &= dst[offset + size] == 0xaa;
+            std_memzero(d, size);
+            for (u32 i = 0; i < size; ++i) zero_ok &= d[i] == 0;
+            zero_ok &= dst[offset + size] == 0xaa;
+        }
+    }
+
+    TEST(copy_ok);
+    TEST(cmp_ok);
+    TEST(set_ok);
+    TEST(zero_ok);
+
+    // Offset to the next aligned address
+    TEST(std_align_offset((void *)64, 16) == 0);
+    TEST(std_align_offset((void *)65, 16) == 15);
+    TEST(std_align_offset((void *)79, 16) == 1);
+    TEST(std_align_offset((void *)81, 4) == 3);
+    TEST(std_align_offset((void *)81, 1) == 0);
+}
@@ -1,9 +1,16 @@
+#include "gfx/midi.h"
+#include "gfx/sound_test.h"
 #include "lib/chunk_test.h"
 #include "lib/cli.h"
+#include "lib/job.h"
 #include "lib/math_test.h"
-#include "lib/midi.h"
+#include "lib/mem_stats.h"
+#include "lib/mem_test.h"
+#include "lib/mutex_test.h"
 #include "lib/os_main.h"
 #include "lib/part.h"
+#include "lib/pool.h"
+#include "lib/std_test.h"
 #include "lib/str_test.h"
 #include "lib/text.h"
 
@@ -11,11 +18,21 @@ static void os_main(void) {
     Test *test = test_begin();
 
     chunk_test(test);
+    chunk_cache_test(test);
+    chunk_trim_test(test);
+    chunk_slab_test(test);
+    mem_test(test);
+    mem_stats_test(test);
+    pool_test(test);
+    job_test(test);
+    mutex_test(test);
+    std_test(test);
     str_test(test);
     part_test(test);
     // text_test(test);
-    // midi_test(test);
+    midi_test(test);
     math_test(test);
+    sound_test(test);
     cli_test(test);
 
     test_end(test);
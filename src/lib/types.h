@@ -4,6 +4,7 @@
 
 // Constants
 #define U32_MAX 0xffffffff
+#define U64_MAX 0xffffffffffffffff
 
 // Helper macros
 #define static_assert(cond) _Static_assert(cond, "")
@@ -49,6 +49,10 @@ static i32 v3i_length_sq(v3i a)  { return v3i_dot(a, a); }
 static f32 v3_distance_sq(v3 a, v3 b)    { return v3_length_sq(a - b); }
 static i32 v3i_distance_sq(v3i a, v3i b) { return v3i_length_sq(a - b); }
 
+static v3 v3_abs(v3 a) { return (v3){f_abs(a.x), f_abs(a.y), f_abs(a.z)}; }
+static v3 v3_min(v3 a, v3 b) { return (v3){f_min(a.x, b.x), f_min(a.y, b.y), f_min(a.z, b.z)}; }
+static v3 v3_max(v3 a, v3 b) { return (v3){f_max(a.x, b.x), f_max(a.y, b.y), f_max(a.z, b.z)}; }
+
 static v2 v2_normalize(v2 v) { return v * f_inv_sqrt(v2_length_sq(v)); }
 static v3 v3_normalize(v3 v) { return v * f_inv_sqrt(v3_length_sq(v)); }
 
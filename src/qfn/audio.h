@@ -4,7 +4,7 @@
 #include "gfx/sound.h"
 #include "gfx/sound_filter.h"
 #include "lib/mat.h"
-#include "lib/mutex.h"
+#include "lib/os_base.h"
 #include "lib/rand.h"
 #include "lib/types.h"
 
@@ -18,67 +18,360 @@
 // Inspiration
 //   - https://www.youtube.com/watch?v=J_FCCvNzbiY
 
+// Spatial gun shots are played by a pool of voices.
+// - Every voice has its own synthesis state, so any number of effects can play at the same time.
+// - A voice is only processed while it is audible. When its envelope is silent, it goes back to the free list.
+// - All AUDIO_VOICE_MAX voices and their synthesis state are allocated by audio_init,
+//   so playing an effect never allocates on the audio thread.
+//   When all voices are playing the quietest voice at the listener is stolen,
+//   or the new effect is dropped if it would be even quieter.
+#define AUDIO_VOICE_MAX 64
+
+// Immediate mode variables of a single voice
+#define AUDIO_VOICE_VARS 1024
+
+typedef struct Audio_Voice Audio_Voice;
+struct Audio_Voice {
+    Sound snd;
+    v3 pos;
+    f32 freq;
+
+    // Start the envelope in the next block
+    bool trigger;
+
+    // Envelope at the end of the last block, 1 for a voice that has not started yet
+    f32 level;
+
+    Audio_Voice *next;
+};
+
+// Events are sent from the game thread to the audio thread without locking.
+// Every event is timestamped with the sample it should start playing on,
+// so events are not merged or delayed to the start of the next audio block.
+typedef enum {
+    Audio_Event_Jump,
+    Audio_Event_Shoot,
+    Audio_Event_Hurt,
+
+    // Spatial gun shot at 'pos' (relative to the listener) with 'freq'
+    Audio_Event_Effect,
+
+    // Game over or win state changed
+    Audio_Event_State,
+
+    // Muted or unmuted
+    Audio_Event_Mute,
+
+    // Play 'song' instead of the generated music, or the generated music again if 0
+    // The sender owns the song, it has to stay valid until it is replaced and the audio thread has stopped.
+    Audio_Event_Song,
+} Audio_Event_Type;
+
 typedef struct {
-    bool active;
+    Audio_Event_Type type;
+
+    // Sample index to start playing
+    u64 time;
+
     v3 pos;
     f32 freq;
-} Audio_Effect;
+    bool over;
+    bool win;
+    bool mute;
+    Sequencer *song;
+} Audio_Event;
 
+// Single producer, single consumer ring buffer
+// The game thread writes at 'write', the audio thread reads at 'read'.
+// Both indices only grow, the slot is the index modulo the size.
+#define AUDIO_QUEUE_SIZE 256
+
+// The indices are padded to keep them on separate cache lines.
+// Memory is only 16 byte aligned, so we can't use alignas(64).
 typedef struct {
-    Mutex mutex;
-    Sound snd;
+    volatile u32 write;
+    u8 pad0[124];
+    volatile u32 read;
+    u8 pad1[124];
+    Audio_Event events[AUDIO_QUEUE_SIZE];
+} Audio_Queue;
+
+// Called by the producer, returns false if the queue is full
+static bool audio_queue_push(Audio_Queue *queue, Audio_Event event) {
+    u32 write = queue->write;
+    u32 read = __atomic_load_n(&queue->read, __ATOMIC_ACQUIRE);
+    if (write - read >= AUDIO_QUEUE_SIZE) return false;
+    queue->events[write % AUDIO_QUEUE_SIZE] = event;
+    __atomic_store_n(&queue->write, write + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Called by the consumer, get the oldest event without removing it
+static Audio_Event *audio_queue_peek(Audio_Queue *queue) {
+    u32 read = queue->read;
+    u32 write = __atomic_load_n(&queue->write, __ATOMIC_ACQUIRE);
+    if (read == write) return 0;
+    return queue->events + read % AUDIO_QUEUE_SIZE;
+}
+
+// Called by the consumer, remove the oldest event
+static void audio_queue_pop(Audio_Queue *queue) {
+    __atomic_store_n(&queue->read, queue->read + 1, __ATOMIC_RELEASE);
+}
+
+typedef struct {
+    Audio_Queue queue;
+
+    // Written by the audio thread at the start of every block, read by the game thread
+    volatile u64 block_sample;
+    volatile u64 block_time;
+    volatile u32 block_size;
+
+    // Game thread
     bool mute;
+    bool over;
+    bool win;
+    m4 inv_mtx;
+    u32 stat_events;
+    u32 stat_dropped;
+
+    // Audio thread
+    Sound snd;
+    u64 sample;
+    bool muted;
     bool play_shoot;
     bool play_jump;
     bool play_hurt;
-    bool over;
-    bool win;
-    v3 pos;
+    bool play_over;
+    bool play_win;
+    Sequencer *song;
 
-    u32 shoot_ix;
-    Audio_Effect shoot[4];
-    m4 inv_mtx;
+    // Spatial effects
+    Audio_Voice *voice_list; // Playing
+    Audio_Voice *voice_free; // Silent, ready to be reused
+    u32 voice_count;         // Playing voices
+    u32 stat_voice_peak;     // Most voices playing at the same time
+    u32 stat_voice_stolen;
+    u32 stat_voice_dropped;
 } Audio;
 
+// Add a block of a single voice to 'out', returns the number of samples it is audible for
+static u32 audio_voice_block(Audio_Voice *voice, u32 count, v2 *out) {
+    f32 env[SOUND_BLOCK_SIZE];
+    f32 wave[SOUND_BLOCK_SIZE];
+    f32 wave2[SOUND_BLOCK_SIZE];
+
+    Sound *vs = &voice->snd;
+    sound_begin(vs);
+    u32 n = sound_adsr_block(vs, count, env, voice->trigger, 100, 16.0, 0);
+    sound_saw_table_block(vs, n, wave, voice->freq, 0);
+    sound_noise_white_block(vs, n, wave2);
+    for (u32 j = 0; j < n; ++j) wave[j] = wave[j] * .8 + wave2[j] * .4;
+    sound_noise_freq_block(vs, n, wave2, NOTE_C, 0.5f);
+    for (u32 j = 0; j < n; ++j) wave[j] = env[j] * (wave[j] + wave2[j]);
+    sound_lowpass_block(vs, n, wave, NOTE_C, wave);
+    sound_pan_block(vs, n, out, voice->pos, wave);
+    voice->trigger = false;
+    voice->level = n ? env[n - 1] : 0.0f;
+    return n;
+}
+
+// Create the sound state, call this before the audio thread starts.
+// The oscillator tables and all voices are allocated here, so the audio thread never has to.
+static void audio_init(Audio *audio, Memory *mem) {
+    audio->snd = sound_init(mem);
+    Sound_Wavetable *wavetable = sound_wavetable(&audio->snd);
+    for (u32 i = 0; i < AUDIO_VOICE_MAX; ++i) {
+        Audio_Voice *voice = mem_struct(mem, Audio_Voice);
+        voice->snd.imm = imm_new(mem, AUDIO_VOICE_VARS);
+        voice->snd.rand = rand_fork(&audio->snd.rand);
+        voice->snd.wavetable = wavetable;
+
+        // Variables larger than a pointer, like the delay lines of sound_pan_block, are allocated on first use.
+        // An empty block reaches every variable, without changing the envelope or the noise.
+        audio_voice_block(voice, 0, 0);
+
+        voice->next = audio->voice_free;
+        audio->voice_free = voice;
+    }
+}
+
+// Sample index at which an event sent now should be played.
+// Events are played one block later than the game thread sends them,
+// but the time between events is preserved with sample accuracy.
+static u64 audio_event_time(Audio *audio) {
+    u64 block_sample = __atomic_load_n(&audio->block_sample, __ATOMIC_ACQUIRE);
+    u64 block_time = __atomic_load_n(&audio->block_time, __ATOMIC_RELAXED);
+    u32 block_size = __atomic_load_n(&audio->block_size, __ATOMIC_RELAXED);
+
+    u64 now = os_time();
+    u64 elapsed = now > block_time ? (now - block_time) * SOUND_SAMPLE_RATE / 1000 / 1000 : 0;
+    if (elapsed > block_size) elapsed = block_size;
+    return block_sample + block_size + elapsed;
+}
+
+// Send an event that starts playing at a specific sample index
+static void audio_send_at(Audio *audio, Audio_Event event, u64 time) {
+    event.time = time;
+    audio->stat_events++;
+    if (!audio_queue_push(&audio->queue, event)) audio->stat_dropped++;
+}
+
+// Send an event to the audio thread, only call this from the game thread
+static void audio_send(Audio *audio, Audio_Event event) {
+    audio_send_at(audio, event, audio_event_time(audio));
+}
+
 // Play Jump sound
 static void audio_jump(Audio *audio) {
-    mutex_lock(&audio->mutex);
-    audio->play_jump = 1;
-    mutex_unlock(&audio->mutex);
+    audio_send(audio, (Audio_Event){.type = Audio_Event_Jump});
 }
 
 // Play Gun shooting sound
 static void audio_shoot(Audio *audio) {
-    mutex_lock(&audio->mutex);
-    audio->play_shoot = 1;
-    mutex_unlock(&audio->mutex);
+    audio_send(audio, (Audio_Event){.type = Audio_Event_Shoot});
+}
+
+// Play the sound of the player getting hurt
+static void audio_hurt(Audio *audio) {
+    audio_send(audio, (Audio_Event){.type = Audio_Event_Hurt});
+}
+
+// Play a gun shot at a world position
+static void audio_effect(Audio *audio, v3 world_pos, f32 freq) {
+    v3 pos = m4_mul_pos(audio->inv_mtx, world_pos);
+    audio_send(audio, (Audio_Event){.type = Audio_Event_Effect, .pos = pos, .freq = freq});
+}
+
+// Play a gun shot at the listener position
+static void audio_effect_local(Audio *audio, f32 freq) {
+    audio_send(audio, (Audio_Event){.type = Audio_Event_Effect, .freq = freq});
+}
+
+// Update the game over music, only sends an event when the state changes
+static void audio_state(Audio *audio, bool over, bool win) {
+    if (audio->over == over && audio->win == win) return;
+    audio->over = over;
+    audio->win = win;
+    audio_send(audio, (Audio_Event){.type = Audio_Event_State, .over = over, .win = win});
 }
 
-static f32 music_note(Sound *sound, bool extra, bool down, f32 freq) {
+// Mute or unmute all audio, only sends an event when the state changes
+static void audio_mute(Audio *audio, bool mute) {
+    if (audio->mute == mute) return;
+    audio->mute = mute;
+    audio_send(audio, (Audio_Event){.type = Audio_Event_Mute, .mute = mute});
+}
+
+// Called by the audio thread before generating a block of 'size' samples
+static void audio_block_begin(Audio *audio, u32 size) {
+    __atomic_store_n(&audio->block_time, os_time(), __ATOMIC_RELAXED);
+    __atomic_store_n(&audio->block_size, size, __ATOMIC_RELAXED);
+    __atomic_store_n(&audio->block_sample, audio->sample, __ATOMIC_RELEASE);
+}
+
+// Loudness of a voice at the listener, with the same distance gain as sound_pan
+static f32 audio_voice_loudness(f32 level, v3 pos) {
+    f32 distance_sq = v3_length_sq(pos);
+    if (distance_sq <= 1) return level;
+    return level * f_inv_sqrt(distance_sq);
+}
+
+// Get a voice for a new effect at 'pos', returns 0 if the effect should be dropped
+static Audio_Voice *audio_voice_alloc(Audio *audio, v3 pos) {
+    Audio_Voice *voice = audio->voice_free;
+    if (voice) {
+        // Reuse a silent voice
+        audio->voice_free = voice->next;
+        audio->voice_count++;
+        if (audio->voice_count > audio->stat_voice_peak) audio->stat_voice_peak = audio->voice_count;
+    } else {
+        // Steal the quietest voice, it keeps playing from its current state
+        Audio_Voice *quiet = 0;
+        f32 quiet_loudness = audio_voice_loudness(1.0f, pos);
+        for (Audio_Voice *other = audio->voice_list; other; other = other->next) {
+            f32 loudness = audio_voice_loudness(other->level, other->pos);
+            if (loudness >= quiet_loudness) continue;
+            quiet = other;
+            quiet_loudness = loudness;
+        }
+
+        if (quiet) audio->stat_voice_stolen++;
+        else audio->stat_voice_dropped++;
+        return quiet;
+    }
+
+    voice->next = audio->voice_list;
+    audio->voice_list = voice;
+    return voice;
+}
+
+// Apply all events that should start on the current sample
+static void audio_receive(Audio *audio) {
+    for (;;) {
+        Audio_Event *event = audio_queue_peek(&audio->queue);
+        if (!event) break;
+        if (event->time > audio->sample) break;
+
+        if (event->type == Audio_Event_Jump) audio->play_jump = 1;
+        if (event->type == Audio_Event_Shoot) audio->play_shoot = 1;
+        if (event->type == Audio_Event_Hurt) audio->play_hurt = 1;
+        if (event->type == Audio_Event_State) {
+            audio->play_over = event->over;
+            audio->play_win = event->win;
+        }
+        if (event->type == Audio_Event_Mute) audio->muted = event->mute;
+        if (event->type == Audio_Event_Song) audio->song = event->song;
+        if (event->type == Audio_Event_Effect) {
+            Audio_Voice *voice = audio_voice_alloc(audio, event->pos);
+            if (voice) {
+                // Full level until it is played, so the next effect in this block can't steal it
+                voice->trigger = true;
+                voice->level = 1.0f;
+                voice->pos = event->pos;
+                voice->freq = event->freq;
+            }
+        }
+        audio_queue_pop(&audio->queue);
+    }
+}
+
+// ==== Synthesis ====
+//
+// Samples are generated in blocks of at most SOUND_BLOCK_SIZE samples.
+// A block ends at the next event or beat, so gates and notes are constant within a block.
+// Triggers (events and random noise) are single sample gates, and get a block of their own.
+// Pitched saw and pulse waves come from the band-limited wavetables, sines use the SIMD polynomial.
+
+// Add a note with a band-limited saw wave to 'out'
+static void music_note(Sound *sound, u32 count, f32 *out, bool extra, bool down, f32 freq) {
     float a = 0.5f;
     float d = 0.5f;
     float s = 0.5f;
 
-    f32 volume = sound_adsr(sound, down, a, d, s);
-    f32 out = 0.0f;
-    out += volume * sound_saw(sound, freq, 0);
-    if (extra) out += volume * sound_saw(sound, freq * 1.001, 0);
-    out = sound_lowpass(sound, 50.0f, out);
-    return out;
+    f32 volume[SOUND_BLOCK_SIZE];
+    f32 wave[SOUND_BLOCK_SIZE];
+    f32 wave2[SOUND_BLOCK_SIZE];
+    u32 n = sound_adsr_block(sound, count, volume, down, a, d, s);
+    sound_saw_table_block(sound, n, wave, freq, 0);
+    if (extra) {
+        sound_saw_table_block(sound, n, wave2, freq * 1.001, 0);
+        sound_block_mix(n, wave, wave2, 1.0f);
+    }
+    sound_block_mul(n, wave, wave, volume);
+    sound_lowpass_block(sound, n, wave, 50.0f, wave);
+    sound_block_mix(n, out, wave, 1.0f);
 }
 
-static f32 music_base(Sound *sound, u32 beat) {
+static void music_base(Sound *sound, u32 count, f32 *out, u32 beat) {
     float base_c = OCT_3 * NOTE_C;
     float base_f = OCT_2 * NOTE_F;
     u32 note = (beat / 8) % 2;
-
-    float out = 0.0f;
-    out += music_note(sound, false, note == 0, base_c);
-    out += music_note(sound, false, note == 1, base_f);
-    return out;
+    music_note(sound, count, out, false, note == 0, base_c);
+    music_note(sound, count, out, false, note == 1, base_f);
 }
 
-static f32 music_melody(Sound *sound, u32 beat) {
+static void music_melody(Sound *sound, u32 count, f32 *out, u32 beat) {
     // Every whole note
     u32 note = beat / 4;
     u32 voice_ix = note % 2;
@@ -88,81 +381,155 @@ static f32 music_melody(Sound *sound, u32 beat) {
         voice_freq[voice_ix] = freq;
     }
 
-    f32 out = 0.0f;
-    out += music_note(sound, true, voice_ix == 0, voice_freq[0]);
-    out += music_note(sound, true, voice_ix == 1, voice_freq[1]);
-    return out;
+    music_note(sound, count, out, true, voice_ix == 0, voice_freq[0]);
+    music_note(sound, count, out, true, voice_ix == 1, voice_freq[1]);
 }
 
-static v2 audio_sample(Audio *audio) {
-    v2 out = {0, 0};
+// Sine wave with its frequency modulated by another sine wave
+// out = sin(freq * (1 + sin(mod_freq) * depth))
+static void audio_fm(Sound *sound, u32 count, f32 *out, f32 freq, f32 mod_freq, f32 depth) {
+    f32 fm[SOUND_BLOCK_SIZE];
+    sound_sine_block(sound, count, fm, mod_freq, 0);
+    for (u32 i = 0; i < count; ++i) fm[i] = 1 + fm[i] * depth;
+    sound_sine_block(sound, count, out, freq, fm);
+}
+
+// Generate a single block, returns the number of samples generated (at most 'count')
+static u32 audio_block(Audio *audio, u32 count, v2 *out) {
+    audio_receive(audio);
+
+    // End the block at the next event
+    if (count > SOUND_BLOCK_SIZE) count = SOUND_BLOCK_SIZE;
+    Audio_Event *next = audio_queue_peek(&audio->queue);
+    if (next && next->time - audio->sample < count) count = next->time - audio->sample;
 
-    if (audio->mute) {
+    // Triggers are a single sample long
+    bool trigger = audio->play_jump || audio->play_shoot || audio->play_hurt;
+    for (Audio_Voice *voice = audio->voice_list; voice; voice = voice->next) trigger |= voice->trigger;
+    if (trigger) count = 1;
+
+    for (u32 i = 0; i < count; ++i) out[i] = 0;
+
+    if (audio->muted) {
         audio->play_jump = 0;
         audio->play_shoot = 0;
-        return out;
+        audio->play_hurt = 0;
+        for (Audio_Voice *voice = audio->voice_list; voice; voice = voice->next) voice->trigger = false;
+        audio->sample += count;
+        return count;
     }
 
     Sound *sound = &audio->snd;
     sound_begin(sound);
 
-    Clock clk = sound_clock(sound, 1.0f, 32);
+    f32 clk_phase[SOUND_BLOCK_SIZE];
+    Clock clk = sound_clock_block(sound, &count, clk_phase, 1.0f, 32);
+
+    f32 mono[SOUND_BLOCK_SIZE];
+    f32 env[SOUND_BLOCK_SIZE];
+    f32 wave[SOUND_BLOCK_SIZE];
+    f32 wave2[SOUND_BLOCK_SIZE];
+    u32 n = 0;
 
-    f32 out_mono = 0;
-    out_mono += 0.1f * music_base(sound, clk.index);
-    out_mono += 0.1f * music_melody(sound, clk.index);
+    // Generated music, unless a song is playing
+    u32 music_count = audio->song ? 0 : count;
+    sound_block_fill(count, wave, 0);
+    music_base(sound, music_count, wave, clk.index);
+    music_melody(sound, music_count, wave, clk.index);
+    if (audio->song) sequencer_render(audio->song, count, wave);
+    sound_block_fill(count, mono, 0);
+    sound_block_mix(count, mono, wave, 0.1f);
 
     f32 chance = 1.0f / 128.0f;
     f32 volume = 0.02f;
 
-    bool play_noise0 = clk.trigger && rand_choice(G->rand, chance);
-    bool play_noise1 = clk.trigger && rand_choice(G->rand, chance);
-    bool play_noise2 = clk.trigger && rand_choice(G->rand, chance);
-    bool play_noise3 = clk.trigger && rand_choice(G->rand, chance);
-    bool play_noise4 = clk.trigger && rand_choice(G->rand, chance);
-    out_mono += volume * sound_adsr(sound, play_noise0, 400, 1.0, 0) * sound_noise_white(sound);
-    out_mono += volume * sound_adsr(sound, play_noise1, 2, 1.0, 0) * clk.phase * sound_pulse(sound, NOTE_C * clk.phase, 0, 0.5f);
-    out_mono += volume * sound_adsr(sound, play_noise2, 0.5, 0.5, 0) * sound_sine(sound, NOTE_C * (1 + sound_sine(sound, 4, 0) * .5f), 0);
-    out_mono += volume * sound_adsr(sound, play_noise3, 1, 0.5, 0) * sound_sine(sound, NOTE_F * (1 + sound_sine(sound, 2, 0) * .5f), 0);
-    out_mono += volume * sound_adsr(sound, play_noise4, 4, 1, 0) * sound_sine(sound, NOTE_C * (1 + sound_sine(sound, 8, 0) * .5f), 0);
-
-    out_mono += 0.5f * sound_adsr(sound, audio->play_hurt, 400, 4.0, 0) * sound_lowpass(sound, 1000, sound_noise_freq(sound, 80, 0.5));
-
-    f32 jump_vol = sound_adsr(sound, audio->play_jump, 400, 4.0, 0);
-    out_mono += 0.1 * jump_vol * sound_sine(sound, NOTE_C * (1 + 0.8 * sound_sine(sound, 8, 0)), 0);
-    out_mono +=
-        1.0 * sound_lowpass(
-                  sound, NOTE_C,
-                  sound_adsr(sound, audio->play_shoot, 400, 16.0, 0) * (sound_noise_white(sound) * .8 + sound_noise_freq(sound, NOTE_C / 4, 0.5f))
-              );
-
-    // out_mono += 0.04 * (audio->over || audio->win) * sound_sine(sound, NOTE_C, sound_sine(sound, NOTE_C * (1 + sound_sine(sound, 0.01, 0)*0.2), 0)
-    // * sound_sine(sound, 2, 0) * sound_sine(sound, .01, 0)) *
-    //             sound_sine(sound, 1.0f/4, 0) * sound_sine(sound, .01, 0);
+    bool play_noise0 = clk.trigger && rand_choice(&sound->rand, chance);
+    bool play_noise1 = clk.trigger && rand_choice(&sound->rand, chance);
+    bool play_noise2 = clk.trigger && rand_choice(&sound->rand, chance);
+    bool play_noise3 = clk.trigger && rand_choice(&sound->rand, chance);
+    bool play_noise4 = clk.trigger && rand_choice(&sound->rand, chance);
 
+    n = sound_adsr_block(sound, count, env, play_noise0, 400, 1.0, 0);
+    sound_noise_white_block(sound, n, wave);
+    sound_block_mul(n, wave, wave, env);
+    sound_block_mix(n, mono, wave, volume);
+
+    n = sound_adsr_block(sound, count, env, play_noise1, 2, 1.0, 0);
+    sound_pulse_table_block(sound, n, wave, NOTE_C, clk_phase, 0.5f);
+    sound_block_mul(n, wave, wave, env);
+    sound_block_mul(n, wave, wave, clk_phase);
+    sound_block_mix(n, mono, wave, volume);
+
+    n = sound_adsr_block(sound, count, env, play_noise2, 0.5, 0.5, 0);
+    audio_fm(sound, n, wave, NOTE_C, 4, .5f);
+    sound_block_mul(n, wave, wave, env);
+    sound_block_mix(n, mono, wave, volume);
+
+    n = sound_adsr_block(sound, count, env, play_noise3, 1, 0.5, 0);
+    audio_fm(sound, n, wave, NOTE_F, 2, .5f);
+    sound_block_mul(n, wave, wave, env);
+    sound_block_mix(n, mono, wave, volume);
+
+    n = sound_adsr_block(sound, count, env, play_noise4, 4, 1, 0);
+    audio_fm(sound, n, wave, NOTE_C, 8, .5f);
+    sound_block_mul(n, wave, wave, env);
+    sound_block_mix(n, mono, wave, volume);
+
+    // Hurt
+    n = sound_adsr_block(sound, count, env, audio->play_hurt, 400, 4.0, 0);
+    sound_noise_freq_block(sound, n, wave, 80, 0.5);
+    sound_lowpass_block(sound, n, wave, 1000, wave);
+    sound_block_mul(n, wave, wave, env);
+    sound_block_mix(n, mono, wave, 0.5f);
+
+    // Jump
+    n = sound_adsr_block(sound, count, env, audio->play_jump, 400, 4.0, 0);
+    audio_fm(sound, n, wave, NOTE_C, 8, 0.8f);
+    sound_block_mul(n, wave, wave, env);
+    sound_block_mix(n, mono, wave, 0.1f);
+
+    // Shoot
+    n = sound_adsr_block(sound, count, env, audio->play_shoot, 400, 16.0, 0);
+    sound_noise_white_block(sound, n, wave);
+    sound_noise_freq_block(sound, n, wave2, NOTE_C / 4, 0.5f);
+    for (u32 i = 0; i < n; ++i) wave[i] = env[i] * (wave[i] * .8 + wave2[i]);
+    sound_lowpass_block(sound, n, wave, NOTE_C, wave);
+    sound_block_mix(n, mono, wave, 1.0f);
+
+    // Game over and win music, the filter cutoff is modulated once per block
     {
-        f32 wawa = .5 + sound_sine(sound, 2, 0) / 2;
-        f32 volume1 = 1.0 + sound_sine(sound, 1.0f / 4, 0) / 4;
-        if (!(audio->over || audio->win)) volume1 = 0;
+        n = audio->play_over || audio->play_win ? count : 0;
+        sound_sine_block(sound, n, wave2, 2, 0);
+        f32 wawa = n ? .5 + wave2[0] / 2 : 0;
+        sound_sine_block(sound, n, env, 1.0f / 4, 0);
         f32 freq = NOTE_C / 4;
-        if (audio->win) freq *= 2;
-        out_mono += 0.05 * volume1 * sound_filter(sound, wawa * NOTE_C * 4, sound_saw(sound, freq, 0)).band_pass;
+        if (audio->play_win) freq *= 2;
+        sound_saw_table_block(sound, n, wave, freq, 0);
+        sound_filter_block(sound, n, 0, wave, 0, wawa * NOTE_C * 4, wave);
+        for (u32 i = 0; i < n; ++i) wave[i] *= 1.0 + env[i] / 4;
+        sound_block_mix(n, mono, wave, 0.05f);
     }
 
     audio->play_jump = 0;
     audio->play_shoot = 0;
     audio->play_hurt = 0;
 
-    for (u32 i = 0; i < array_count(audio->shoot); ++i) {
-        Audio_Effect *eff = audio->shoot + i;
-        f32 volume = sound_adsr(sound, eff->active, 100, 16.0, 0);
-        f32 noise = sound_saw(sound, eff->freq, 0) * .8 + sound_noise_white(sound) * .4 + sound_noise_freq(sound, NOTE_C, 0.5f);
-        f32 value = sound_lowpass(sound, NOTE_C, volume * noise);
-        out += sound_pan(sound, value, eff->pos);
-        eff->active = false;
+    // Spatial effects, silent voices go back to the free list
+    for (Audio_Voice **link = &audio->voice_list; *link;) {
+        Audio_Voice *voice = *link;
+        n = audio_voice_block(voice, count, out);
+
+        if (n == 0) {
+            *link = voice->next;
+            voice->next = audio->voice_free;
+            audio->voice_free = voice;
+            audio->voice_count--;
+        } else {
+            link = &voice->next;
+        }
     }
 
-    out += (v2){out_mono, out_mono};
+    for (u32 i = 0; i < count; ++i) out[i] = (out[i] + (v2){mono[i], mono[i]}) * 0.5f;
 
     Freeverb_Config cfg = {
         .room = 0.8f,
@@ -171,11 +538,20 @@ static v2 audio_sample(Audio *audio) {
         .dry = 1.0f,
     };
 
-    if (audio->over || audio->win) {
+    if (audio->play_over || audio->play_win) {
         cfg.dry = 0.5;
     }
 
-    out = sound_freeverb2(sound, cfg, out * 0.5f) * 1.0f;
-    // out = sound_reverb3(sound, out * 0.5f) * 1.0f;
-    return out;
+    sound_freeverb2_block(sound, count, out, cfg);
+    audio->sample += count;
+    return count;
+}
+
+// Generate 'count' samples, called by the audio thread
+static void audio_render(Audio *audio, u32 count, v2 *out) {
+    while (count > 0) {
+        u32 size = audio_block(audio, count, out);
+        out += size;
+        count -= size;
+    }
 }
@@ -0,0 +1,353 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// audio_render.c - Render the game audio without a sound card
+//
+// Plays a fixed script of game events (shots, jumps, hurt, game over and win) through the game audio,
+// and reports how long the synthesis took. The output is deterministic, so two WAV files can be compared.
+//
+// Build with: ./build build src/qfn/audio_render.c out/audio_render --release
+// Render:     out/audio_render render out/audio.wav 10
+// Benchmark:  out/audio_render bench 60
+// Primitives: out/audio_render dsp
+// Midi:       out/audio_render midi song.mid out/song.wav
+#include "lib/cli.h"
+#include "lib/os_main.h"
+#include "qfn/audio.h"
+
+// Same size as a typical audio callback
+#define RENDER_BLOCK_SIZE 512
+
+// The script advances in steps of 50 ms
+#define RENDER_STEP (SOUND_SAMPLE_RATE / 20)
+
+// Parse a length in whole seconds, returns 0 if it is not a positive number
+static u64 render_parse_seconds(char *str) {
+    u64 value = 0;
+    char *c = str;
+    for (; *c >= '0' && *c <= '9'; ++c) {
+        value = value * 10 + (*c - '0');
+        if (value > U32_MAX) return 0;
+    }
+    if (c == str || *c) return 0;
+    return value;
+}
+
+// Allocate room for 'count' samples.
+// Allocation sizes are 32 bit, including the rounding up to whole chunks (see chunk_large_alloc).
+static v2 *render_samples_new(u64 count) {
+    if (count == 0 || count * sizeof(v2) > U32_MAX - CHUNK_SIZE) {
+        fmt_s(G->fmt, "The length is not valid or too long\n");
+        os_exit(1);
+    }
+    return mem_array_uninit(G->mem, v2, count);
+}
+
+// Send all scripted events in [start, end)
+// The script repeats every 4 seconds, the second half of the recording is the game over and win music.
+static void render_script(Audio *audio, u64 start, u64 end, u64 total) {
+    u64 first = (start + RENDER_STEP - 1) / RENDER_STEP * RENDER_STEP;
+    for (u64 time = first; time < end; time += RENDER_STEP) {
+        u32 step = (time / RENDER_STEP) % 80;
+
+        // Jumps
+        if (step == 0 || step == 60) audio_send_at(audio, (Audio_Event){.type = Audio_Event_Jump}, time);
+
+        // The player fires a burst
+        if (step >= 5 && step < 20 && step % 5 == 0) {
+            audio_send_at(audio, (Audio_Event){.type = Audio_Event_Shoot}, time);
+            audio_send_at(audio, (Audio_Event){.type = Audio_Event_Effect, .freq = 100 + step * 10}, time);
+        }
+
+        // The player gets hurt
+        if (step == 25) audio_send_at(audio, (Audio_Event){.type = Audio_Event_Hurt}, time);
+
+        // Monsters circling around the player shoot back
+        if (step >= 30 && step < 50) {
+            f32 angle = (f32)(step - 30) / 20;
+            v3 pos = {f_cos2pi(angle) * 4, 0, f_sin2pi(angle) * 4};
+            audio_send_at(audio, (Audio_Event){.type = Audio_Event_Effect, .pos = pos, .freq = 200 + step * 5}, time);
+        }
+
+        // A large arena, dozens of monsters fire at the same time
+        if (step == 55 || step == 57) {
+            for (u32 i = 0; i < 48; ++i) {
+                f32 angle = (f32)i / 48;
+                f32 distance = 2 + i % 8 * 4;
+                v3 pos = {f_cos2pi(angle) * distance, 0, f_sin2pi(angle) * distance};
+                audio_send_at(audio, (Audio_Event){.type = Audio_Event_Effect, .pos = pos, .freq = 200 + i * 10}, time);
+            }
+        }
+
+        // Game over after half of the recording, then win
+        bool over = time >= total / 2 && time < total * 3 / 4;
+        bool win = time >= total * 3 / 4;
+        if (over != audio->over || win != audio->win) {
+            audio->over = over;
+            audio->win = win;
+            audio_send_at(audio, (Audio_Event){.type = Audio_Event_State, .over = over, .win = win}, time);
+        }
+    }
+}
+
+// Render 'count' samples, returns the time spent in the synthesizer in microseconds
+static u64 render_audio(Audio *audio, v2 *samples, u64 count, bool script) {
+    u64 duration = 0;
+    for (u64 start = 0; start < count; start += RENDER_BLOCK_SIZE) {
+        u32 size = RENDER_BLOCK_SIZE;
+        if (start + size > count) size = count - start;
+        if (script) render_script(audio, start, start + size, count);
+
+        u64 t0 = os_time();
+        audio_render(audio, size, samples + start);
+        duration += os_time() - t0;
+
+        for (u32 i = 0; i < size; ++i) samples[start + i] = sound_clip2(samples[start + i]);
+    }
+    return duration;
+}
+
+static void render_report(Audio *audio, u64 count, u64 duration) {
+    if (duration == 0) duration = 1;
+    fmt_suu(G->fmt, "Rendered ", count / SOUND_SAMPLE_RATE, " seconds in ", duration / 1000, " ms\n");
+    fmt_su(G->fmt, "  ", count * 1000 * 1000 / duration, " samples/second\n");
+    fmt_sf(G->fmt, "  ", (f32)duration * 1000.0f / (f32)count, " ns/sample\n");
+    fmt_su(G->fmt, "  ", count * 1000 * 1000 / SOUND_SAMPLE_RATE / duration, "x realtime\n");
+    fmt_suuu(G->fmt, "  ", audio->stat_voice_peak, " voices, ", audio->stat_voice_stolen, " stolen, ", audio->stat_voice_dropped, " dropped\n");
+}
+
+// ==== Filters and envelopes ====
+
+// Number of samples per primitive in the 'dsp' benchmark
+#define RENDER_DSP_SAMPLES (SOUND_SAMPLE_RATE * 10)
+
+typedef enum {
+    Render_Dsp_Lowpass,
+    Render_Dsp_Filter,
+    Render_Dsp_Adsr,
+    Render_Dsp_Count,
+} Render_Dsp;
+
+static char *RENDER_DSP_NAME[Render_Dsp_Count] = {"sound_lowpass", "sound_filter", "sound_adsr"};
+
+// Run a primitive one sample at a time, returns the time in microseconds.
+// With 'modulate' the parameter changes every sample, so the coefficients are recomputed every sample.
+static u64 render_dsp_scalar(Render_Dsp dsp, bool modulate, f32 *out) {
+    Sound sound = sound_init(G->mem);
+    u64 t0 = os_time();
+    for (u32 i = 0; i < RENDER_DSP_SAMPLES; ++i) {
+        f32 in = (f32)(i % 128) / 64.0f - 1.0f;
+        f32 param = modulate ? 1000.0f + (i & 1) : 1000.0f;
+        bool down = (i / 4800) % 2 == 0;
+
+        sound_begin(&sound);
+        if (dsp == Render_Dsp_Lowpass) out[i] = sound_lowpass(&sound, param, in);
+        if (dsp == Render_Dsp_Filter) out[i] = sound_filter(&sound, param, in).band_pass;
+        if (dsp == Render_Dsp_Adsr) out[i] = sound_adsr(&sound, down, param, param / 100.0f, 0.5f);
+    }
+    return os_time() - t0;
+}
+
+// Same as render_dsp_scalar, with the block variant
+static u64 render_dsp_block(Render_Dsp dsp, f32 *out) {
+    Sound sound = sound_init(G->mem);
+    f32 in[SOUND_BLOCK_SIZE];
+    for (u32 i = 0; i < SOUND_BLOCK_SIZE; ++i) in[i] = (f32)i / 64.0f - 1.0f;
+
+    u64 t0 = os_time();
+    for (u32 i = 0; i + SOUND_BLOCK_SIZE <= RENDER_DSP_SAMPLES; i += SOUND_BLOCK_SIZE) {
+        bool down = (i / 4800) % 2 == 0;
+
+        sound_begin(&sound);
+        if (dsp == Render_Dsp_Lowpass) sound_lowpass_block(&sound, SOUND_BLOCK_SIZE, out + i, 1000.0f, in);
+        if (dsp == Render_Dsp_Filter) sound_filter_block(&sound, SOUND_BLOCK_SIZE, 0, out + i, 0, 1000.0f, in);
+        if (dsp == Render_Dsp_Adsr) sound_adsr_block(&sound, SOUND_BLOCK_SIZE, out + i, down, 1000.0f, 10.0f, 0.5f);
+    }
+    return os_time() - t0;
+}
+
+typedef enum {
+    Render_Osc_Sine,
+    Render_Osc_Sine_Block,
+    Render_Osc_Sine_Table,
+    Render_Osc_Saw_Block,
+    Render_Osc_Saw_Table,
+    Render_Osc_Pulse_Block,
+    Render_Osc_Pulse_Table,
+    Render_Osc_Count,
+} Render_Osc;
+
+static char *RENDER_OSC_NAME[Render_Osc_Count] = {
+    "sound_sine", "sound_sine_block", "sound_sine_table_block", "sound_saw_block", "sound_saw_table_block", "sound_pulse_block", "sound_pulse_table_block",
+};
+
+// Run an oscillator, returns the time in microseconds
+static u64 render_osc(Render_Osc osc, f32 *out) {
+    Sound sound = sound_init(G->mem);
+    sound_wavetable(&sound);
+
+    u64 t0 = os_time();
+    if (osc == Render_Osc_Sine) {
+        for (u32 i = 0; i < RENDER_DSP_SAMPLES; ++i) {
+            sound_begin(&sound);
+            out[i] = sound_sine(&sound, 440.0f, 0);
+        }
+    } else {
+        for (u32 i = 0; i + SOUND_BLOCK_SIZE <= RENDER_DSP_SAMPLES; i += SOUND_BLOCK_SIZE) {
+            sound_begin(&sound);
+            if (osc == Render_Osc_Sine_Block) sound_sine_block(&sound, SOUND_BLOCK_SIZE, out + i, 440.0f, 0);
+            if (osc == Render_Osc_Sine_Table) sound_sine_table_block(&sound, SOUND_BLOCK_SIZE, out + i, 440.0f, 0);
+            if (osc == Render_Osc_Saw_Block) sound_saw_block(&sound, SOUND_BLOCK_SIZE, out + i, 440.0f, 0);
+            if (osc == Render_Osc_Saw_Table) sound_saw_table_block(&sound, SOUND_BLOCK_SIZE, out + i, 440.0f, 0);
+            if (osc == Render_Osc_Pulse_Block) sound_pulse_block(&sound, SOUND_BLOCK_SIZE, out + i, 440.0f, 0, 0.5f);
+            if (osc == Render_Osc_Pulse_Table) sound_pulse_table_block(&sound, SOUND_BLOCK_SIZE, out + i, 440.0f, 0, 0.5f);
+        }
+    }
+    return os_time() - t0;
+}
+
+// Compare constant parameters (cached coefficients), modulated parameters (recomputed every sample) and blocks.
+// Then compare the oscillators, with and without wavetables.
+static void render_dsp(void) {
+    f32 *out = mem_array_uninit(G->mem, f32, RENDER_DSP_SAMPLES);
+    f32 scale = 1000.0f / RENDER_DSP_SAMPLES;
+    fmt_s(G->fmt, "ns/sample: constant, modulated, block\n");
+    for (u32 dsp = 0; dsp < Render_Dsp_Count; ++dsp) {
+        f32 constant = render_dsp_scalar(dsp, false, out) * scale;
+        f32 modulated = render_dsp_scalar(dsp, true, out) * scale;
+        f32 block = render_dsp_block(dsp, out) * scale;
+        fmt_ss(G->fmt, "  ", RENDER_DSP_NAME[dsp], "\n");
+        fmt_sfff(G->fmt, "    ", constant, ", ", modulated, ", ", block, "\n");
+    }
+
+    fmt_s(G->fmt, "ns/sample: oscillators at 440 Hz\n");
+    for (u32 osc = 0; osc < Render_Osc_Count; ++osc) {
+        fmt_ss(G->fmt, "  ", RENDER_OSC_NAME[osc], "\n");
+        fmt_sf(G->fmt, "    ", render_osc(osc, out) * scale, "\n");
+    }
+}
+
+static void render_u16(u8 **p, u16 value) {
+    (*p)[0] = value;
+    (*p)[1] = value >> 8;
+    *p += 2;
+}
+
+static void render_u32(u8 **p, u32 value) {
+    render_u16(p, value);
+    render_u16(p, value >> 16);
+}
+
+static void render_tag(u8 **p, char *tag) {
+    std_memcpy(*p, (u8 *)tag, 4);
+    *p += 4;
+}
+
+// Encode as a 16 bit stereo PCM WAV file
+static String render_wav(Memory *mem, v2 *samples, u32 count) {
+    u32 data_size = count * 2 * sizeof(i16);
+    u8 *data = mem_push_uninit(mem, 44 + data_size);
+    u8 *p = data;
+
+    render_tag(&p, "RIFF");
+    render_u32(&p, 36 + data_size);
+    render_tag(&p, "WAVE");
+
+    render_tag(&p, "fmt ");
+    render_u32(&p, 16);
+    render_u16(&p, 1); // PCM
+    render_u16(&p, 2); // Channels
+    render_u32(&p, SOUND_SAMPLE_RATE);
+    render_u32(&p, SOUND_SAMPLE_RATE * 2 * sizeof(i16));
+    render_u16(&p, 2 * sizeof(i16));
+    render_u16(&p, 16);
+
+    render_tag(&p, "data");
+    render_u32(&p, data_size);
+    for (u32 i = 0; i < count; ++i) {
+        render_u16(&p, (i16)(samples[i].x * 32767));
+        render_u16(&p, (i16)(samples[i].y * 32767));
+    }
+    return (String){.data = data, .len = 44 + data_size};
+}
+
+static void render_write(char *output, v2 *samples, u32 count) {
+    File *file = os_open(str_from(output), Open_Write);
+    if (!file) {
+        fmt_ss(G->fmt, "Could not open ", output, "\n");
+        os_exit(1);
+    }
+    String wav = render_wav(G->mem, samples, count);
+    os_write(file, wav.data, wav.len);
+    os_close(file);
+    fmt_ss(G->fmt, "Written to ", output, "\n");
+}
+
+static Audio *render_audio_new(void) {
+    Memory *mem = mem_new();
+    mem_set_name(mem, "sound");
+    Audio *audio = mem_struct(mem, Audio);
+    audio_init(audio, mem);
+    return audio;
+}
+
+static void os_main(void) {
+    Cli *cli = cli_new();
+
+    if (cli_command(cli, "render", "Render the audio script to a WAV file")) {
+        char *output = cli_value(cli, "<Output>", "WAV Output Path");
+        char *seconds = cli_value(cli, "<Seconds>", "Length in seconds");
+        cli_help(cli);
+
+        u64 count = render_parse_seconds(seconds) * SOUND_SAMPLE_RATE;
+        v2 *samples = render_samples_new(count);
+        Audio *audio = render_audio_new();
+        u64 duration = render_audio(audio, samples, count, true);
+        render_write(output, samples, count);
+        render_report(audio, count, duration);
+        os_exit(0);
+    }
+
+    if (cli_command(cli, "midi", "Render a MIDI file to a WAV file")) {
+        char *input = cli_value(cli, "<Input>", "MIDI Input Path");
+        char *output = cli_value(cli, "<Output>", "WAV Output Path");
+        cli_help(cli);
+
+        String data = os_readfile(G->mem, str_from(input));
+        Midi *midi = midi_read(G->mem, &data);
+        if (!midi) {
+            fmt_ss(G->fmt, "Could not read ", input, "\n");
+            os_exit(1);
+        }
+
+        // Play the song instead of the script, with one second to fade out
+        Audio *audio = render_audio_new();
+        Sequencer *song = sequencer_new(G->mem, midi);
+        audio_send_at(audio, (Audio_Event){.type = Audio_Event_Song, .song = song}, 0);
+
+        u64 count = song->length + SOUND_SAMPLE_RATE;
+        v2 *samples = render_samples_new(count);
+        u64 duration = render_audio(audio, samples, count, false);
+        render_write(output, samples, count);
+        render_report(audio, count, duration);
+        os_exit(0);
+    }
+
+    if (cli_command(cli, "bench", "Measure the synthesizer throughput")) {
+        char *seconds = cli_value(cli, "<Seconds>", "Length in seconds");
+        cli_help(cli);
+
+        u64 count = render_parse_seconds(seconds) * SOUND_SAMPLE_RATE;
+        v2 *samples = render_samples_new(count);
+        Audio *audio = render_audio_new();
+        render_report(audio, count, render_audio(audio, samples, count, true));
+        os_exit(0);
+    }
+
+    if (cli_command(cli, "dsp", "Measure the filters, envelopes and oscillators")) {
+        cli_help(cli);
+        render_dsp();
+        os_exit(0);
+    }
+
+    cli_help(cli);
+    os_exit(1);
+}
@@ -6,6 +6,7 @@
 #include "gfx/image.h"
 #include "lib/mat.h"
 #include "lib/mem.h"
+#include "lib/pool.h"
 #include "lib/vec.h"
 
 // Centered quad facing +z
@@ -161,10 +162,8 @@ typedef struct {
     f32 distance;
 } Collide_Result;
 
-static bool collide_quad_ray(Collide_Result *res, m4 quad_mtx, v3 ray_pos, v3 ray_dir) {
-    // Matrix inverse, can calculate points from Global to Local
-    m4 mtx_inv = m4_invert_tr(quad_mtx);
-
+// Ray against a quad, with the inverse of the quad matrix
+static bool collide_quad_ray_inv(Collide_Result *res, m4 mtx_inv, v3 ray_pos, v3 ray_dir) {
     // Compute Ray position and direction in quad local space
     v3 ray_pos_local = m4_mul_pos(mtx_inv, ray_pos);
     v3 ray_dir_local = m4_mul_dir(mtx_inv, ray_dir);
@@ -192,6 +191,38 @@ static bool collide_quad_ray(Collide_Result *res, m4 quad_mtx, v3 ray_pos, v3 ra
     return true;
 }
 
+static bool collide_quad_ray(Collide_Result *res, m4 quad_mtx, v3 ray_pos, v3 ray_dir) {
+    // Matrix inverse, can calculate points from Global to Local
+    return collide_quad_ray_inv(res, m4_invert_tr(quad_mtx), ray_pos, ray_dir);
+}
+
+// Is the image solid at a hit position, shots and line of sight pass through the rest
+static bool collision_image_opaque(Image *img, f32 u, f32 v) {
+    v4 *px = image_get(img, (v2i){(u + .5) * img->size.x, (.5 - v) * img->size.y});
+    return px && px->w >= .9f;
+}
+
+// ==== Collision World ====
+//
+// All objects that can be hit in the current frame.
+// - Walls never move, they are stored once in a static BVH (see collision_bvh_new).
+// - Other objects are added every frame, and are sorted into a uniform grid in the xz plane.
+//   A grid cell has the size of a maze cell from level_generate and is centered on it.
+//   Objects are added to every cell they overlap.
+//   The grid wraps around every COLLISION_GRID_SIZE cells, so far away objects can share a cell.
+// - Queries visit both, and only return candidates. The exact test is still done by the caller.
+
+// Size of a grid cell
+#define COLLISION_CELL_SIZE 2.0f
+
+// Number of grid cells in both directions, a power of two
+#define COLLISION_GRID_SIZE 64
+
+// Bounding boxes are made larger by this amount, so flat quads still have a volume.
+// Before finding their grid cells they are made smaller instead,
+// so a quad that exactly fits a cell does not end up in its neighbours.
+#define COLLISION_EPSILON 1e-3f
+
 typedef struct Collision_Object Collision_Object;
 struct Collision_Object {
     m4 mtx;
@@ -199,25 +230,580 @@ struct Collision_Object {
     u32 type;
     void *handle;
     Collision_Object *next;
+
+    // Precomputed inverse of 'mtx', and the direction the quad is facing
+    m4 inv;
+    v3 normal;
+
+    // Bounding box
+    v3 min;
+    v3 max;
+
+    // Grid cells covered by this object (inclusive), only for objects in the grid
+    v2i cell_min;
+    v2i cell_max;
 };
 
+static void collision_object_init(Collision_Object *obj, m4 mtx, Image *img, u32 type, void *handle) {
+    obj->mtx = mtx;
+    obj->img = img;
+    obj->type = type;
+    obj->handle = handle;
+    obj->inv = m4_invert_tr(mtx);
+    obj->normal = v3_normalize(mtx.z);
+
+    // The quad spans half of the x and y axis in both directions
+    v3 radius = (v3_abs(mtx.x) + v3_abs(mtx.y)) / 2 + COLLISION_EPSILON;
+    obj->min = mtx.w - radius;
+    obj->max = mtx.w + radius;
+}
+
+// Same as collide_quad_ray
+static bool collide_object_ray(Collide_Result *res, Collision_Object *obj, v3 ray_pos, v3 ray_dir) {
+    // Cheap rejects with the normal, before transforming the ray
+    if (v3_dot(ray_dir, obj->normal) > 0) return false;
+    if (v3_dot(ray_pos - obj->mtx.w, obj->normal) < 0) return false;
+    return collide_quad_ray_inv(res, obj->inv, ray_pos, ray_dir);
+}
+
+// ==== Static BVH ====
+//
+// Bounding volume hierarchy over objects that never move.
+// - Built once, splits are chosen with the surface area heuristic (SAH) by binning the object centers.
+// - Nodes are stored depth first in a flat array, the first child directly follows its parent.
+// - A leaf points to a range in the object array, which is reordered to match.
+
+// Number of bins per axis for the SAH
+#define COLLISION_BVH_BINS 16
+
+// Nodes with more objects are always split
+#define COLLISION_BVH_LEAF_MAX 4
+
+// Below this depth nodes are split in half, so the depth stays bounded for any input
+#define COLLISION_BVH_SAH_DEPTH 32
+
+// Size of the traversal stack
+#define COLLISION_BVH_STACK 64
+
 typedef struct {
-    Memory *mem;
+    v3 min;
+    v3 max;
+
+    // Leaf: first object, Inner: index of the second child
+    u32 index;
+
+    // Number of objects in a leaf, 0 for inner nodes
+    u32 count;
+
+    // Split axis of an inner node, the first child has the lower centers
+    u32 axis;
+} Collision_Bvh_Node;
+
+typedef struct {
+    u32 node_count;
+    Collision_Bvh_Node *nodes;
+
+    u32 object_count;
     Collision_Object *objects;
+} Collision_Bvh;
+
+// Half of the surface area of a box
+static f32 collision_bvh_area(v3 min, v3 max) {
+    v3 d = max - min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static v3 collision_bvh_center(Collision_Object *obj) {
+    return (obj->min + obj->max) / 2;
+}
+
+static void collision_bvh_swap(Collision_Object *a, Collision_Object *b) {
+    Collision_Object tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+// Build the node for 'count' objects starting at 'first', returns the node index
+static u32 collision_bvh_build(Collision_Bvh *bvh, u32 first, u32 count, u32 depth) {
+    u32 node_index = bvh->node_count++;
+    Collision_Bvh_Node *node = bvh->nodes + node_index;
+    Collision_Object *objects = bvh->objects + first;
+
+    // Bounds of the objects and of their centers
+    v3 min = objects[0].min;
+    v3 max = objects[0].max;
+    v3 center_min = collision_bvh_center(objects);
+    v3 center_max = center_min;
+    for (u32 i = 1; i < count; ++i) {
+        v3 center = collision_bvh_center(objects + i);
+        min = v3_min(min, objects[i].min);
+        max = v3_max(max, objects[i].max);
+        center_min = v3_min(center_min, center);
+        center_max = v3_max(center_max, center);
+    }
+    node->min = min;
+    node->max = max;
+    node->index = first;
+    node->count = count;
+    if (count == 1) return node_index;
+
+    // Cost of a leaf is one test per object, a split costs one extra step plus the tests in both children
+    f32 area = collision_bvh_area(min, max);
+    f32 best_cost = count;
+    u32 best_axis = 0;
+    u32 best_split = 0;
+    v3 extent = center_max - center_min;
+    for (u32 axis = 0; axis < 3 && depth < COLLISION_BVH_SAH_DEPTH; ++axis) {
+        if (extent[axis] <= 0) continue;
+
+        u32 bin_count[COLLISION_BVH_BINS] = {};
+        v3 bin_min[COLLISION_BVH_BINS];
+        v3 bin_max[COLLISION_BVH_BINS];
+        f32 scale = COLLISION_BVH_BINS / extent[axis];
+        for (u32 i = 0; i < count; ++i) {
+            v3 center = collision_bvh_center(objects + i);
+            u32 bin = u_min((center[axis] - center_min[axis]) * scale, COLLISION_BVH_BINS - 1);
+            if (bin_count[bin] == 0) {
+                bin_min[bin] = objects[i].min;
+                bin_max[bin] = objects[i].max;
+            } else {
+                bin_min[bin] = v3_min(bin_min[bin], objects[i].min);
+                bin_max[bin] = v3_max(bin_max[bin], objects[i].max);
+            }
+            bin_count[bin]++;
+        }
+
+        // Area times count of all bins to the right of a split
+        f32 right_cost[COLLISION_BVH_BINS];
+        u32 right_count = 0;
+        v3 right_min = {};
+        v3 right_max = {};
+        for (u32 bin = COLLISION_BVH_BINS - 1; bin > 0; --bin) {
+            if (bin_count[bin]) {
+                right_min = right_count ? v3_min(right_min, bin_min[bin]) : bin_min[bin];
+                right_max = right_count ? v3_max(right_max, bin_max[bin]) : bin_max[bin];
+                right_count += bin_count[bin];
+            }
+            right_cost[bin] = right_count ? collision_bvh_area(right_min, right_max) * right_count : 0;
+        }
+
+        // Split before 'bin'
+        u32 left_count = 0;
+        v3 left_min = {};
+        v3 left_max = {};
+        for (u32 bin = 1; bin < COLLISION_BVH_BINS; ++bin) {
+            if (bin_count[bin - 1]) {
+                left_min = left_count ? v3_min(left_min, bin_min[bin - 1]) : bin_min[bin - 1];
+                left_max = left_count ? v3_max(left_max, bin_max[bin - 1]) : bin_max[bin - 1];
+                left_count += bin_count[bin - 1];
+            }
+            if (left_count == 0 || left_count == count) continue;
+            f32 cost = 1 + (collision_bvh_area(left_min, left_max) * left_count + right_cost[bin]) / area;
+            if (cost >= best_cost) continue;
+            best_cost = cost;
+            best_axis = axis;
+            best_split = bin;
+        }
+    }
+
+    u32 left = 0;
+    if (best_split) {
+        // Move objects left of the split to the front
+        f32 scale = COLLISION_BVH_BINS / extent[best_axis];
+        for (u32 i = 0; i < count; ++i) {
+            v3 center = collision_bvh_center(objects + i);
+            u32 bin = u_min((center[best_axis] - center_min[best_axis]) * scale, COLLISION_BVH_BINS - 1);
+            if (bin < best_split) collision_bvh_swap(objects + i, objects + left++);
+        }
+    } else if (count > COLLISION_BVH_LEAF_MAX) {
+        // No useful split, but too many objects for a leaf
+        left = count / 2;
+    } else {
+        return node_index;
+    }
+
+    node->count = 0;
+    node->axis = best_axis;
+    collision_bvh_build(bvh, first, left, depth + 1);
+    node->index = collision_bvh_build(bvh, first + left, count - left, depth + 1);
+    return node_index;
+}
+
+// Build a BVH over 'count' objects, the objects are reordered
+static Collision_Bvh *collision_bvh_new(Memory *mem, u32 count, Collision_Object *objects) {
+    Collision_Bvh *bvh = mem_struct(mem, Collision_Bvh);
+    bvh->object_count = count;
+    bvh->objects = objects;
+    if (count == 0) return bvh;
+
+    // A binary tree with 'count' leaves has at most 2 * count - 1 nodes
+    bvh->nodes = mem_array_uninit(mem, Collision_Bvh_Node, count * 2 - 1);
+    collision_bvh_build(bvh, 0, count, 0);
+    return bvh;
+}
+
+// Depth first traversal state
+typedef struct {
+    u32 stack_count;
+    u32 stack[COLLISION_BVH_STACK];
+
+    // Remaining objects of the current leaf
+    u32 object;
+    u32 object_end;
+} Collision_Bvh_Iter;
+
+static Collision_Bvh_Iter collision_bvh_iter(Collision_Bvh *bvh) {
+    Collision_Bvh_Iter it = {};
+    if (bvh && bvh->node_count) it.stack[it.stack_count++] = 0;
+    return it;
+}
+
+static void collision_bvh_push(Collision_Bvh_Iter *it, u32 node) {
+    assert(it->stack_count < COLLISION_BVH_STACK, "BVH traversal stack overflow");
+    it->stack[it->stack_count++] = node;
+}
+
+// Does a ray hit the node before 'distance'?
+static bool collision_bvh_ray_hit(Collision_Bvh_Node *node, v3 pos, v3 dir_inv, f32 distance) {
+    v3 t0 = (node->min - pos) * dir_inv;
+    v3 t1 = (node->max - pos) * dir_inv;
+    v3 t_near = v3_min(t0, t1);
+    v3 t_far = v3_max(t0, t1);
+    f32 t_enter = f_max(f_max(t_near.x, t_near.y), f_max(t_near.z, 0));
+    f32 t_exit = f_min(f_min(t_far.x, t_far.y), f_min(t_far.z, distance));
+    return t_enter <= t_exit;
+}
+
+static bool collision_bvh_box_hit(Collision_Bvh_Node *node, v3 min, v3 max) {
+    if (node->max.x < min.x || node->min.x > max.x) return false;
+    if (node->max.y < min.y || node->min.y > max.y) return false;
+    if (node->max.z < min.z || node->min.z > max.z) return false;
+    return true;
+}
+
+// ==== World ====
+
+// An object in a grid cell
+typedef struct Collision_Link Collision_Link;
+struct Collision_Link {
+    Collision_Object *obj;
+    Collision_Link *next;
+};
+
+typedef struct {
+    // Objects that never move
+    Collision_Bvh *bvh;
+
+    // Objects are rebuilt every frame, the pools keep their memory around
+    Pool pool;
+    Collision_Object *objects;
+
+    // Grid cells, indexed by x + z * COLLISION_GRID_SIZE
+    Pool link_pool;
+    Collision_Link *grid[COLLISION_GRID_SIZE * COLLISION_GRID_SIZE];
+
+    // All cells that contain objects (inclusive), only valid if there are objects
+    v2i cell_min;
+    v2i cell_max;
 } Collision_World;
 
-static Collision_World *collision_world_new(Memory *mem) {
+// Create a world, 'bvh' contains the static objects and can be 0
+static Collision_World *collision_world_new(Memory *mem, Collision_Bvh *bvh) {
     Collision_World *world = mem_struct(mem, Collision_World);
-    world->mem = mem;
+    world->bvh = bvh;
+    world->pool = pool_for(mem, Collision_Object);
+    world->link_pool = pool_for(mem, Collision_Link);
     return world;
 }
 
+// Remove all objects that are not static, call this at the start of every frame
+static void collision_world_begin(Collision_World *world) {
+    pool_clear(&world->pool);
+    pool_clear(&world->link_pool);
+    std_memzero((u8 *)world->grid, sizeof(world->grid));
+    world->objects = 0;
+}
+
+// Grid cell containing a coordinate
+static i32 collision_cell(f32 x) {
+    return f_floor(x / COLLISION_CELL_SIZE + 0.5f);
+}
+
+static Collision_Link **collision_grid(Collision_World *world, v2i cell) {
+    u32 mask = COLLISION_GRID_SIZE - 1;
+    return world->grid + ((u32)cell.x & mask) + ((u32)cell.y & mask) * COLLISION_GRID_SIZE;
+}
+
+static bool collision_cell_inside(v2i cell, v2i min, v2i max) {
+    return cell.x >= min.x && cell.y >= min.y && cell.x <= max.x && cell.y <= max.y;
+}
+
+// Add an object for this frame
 static void collision_add(Collision_World *world, m4 mtx, Image *img, u32 type, void *handle) {
-    Collision_Object *obj = mem_struct(world->mem, Collision_Object);
-    obj->mtx = mtx;
-    obj->img = img;
-    obj->type = type;
-    obj->handle = handle;
+    Collision_Object *obj = pool_struct(&world->pool, Collision_Object);
+    collision_object_init(obj, mtx, img, type, handle);
+
+    // Shrink the bounding box, but not past its center
+    v2 center = mtx.w.xz;
+    v2 min = {f_min(obj->min.x + 2 * COLLISION_EPSILON, center.x), f_min(obj->min.z + 2 * COLLISION_EPSILON, center.y)};
+    v2 max = {f_max(obj->max.x - 2 * COLLISION_EPSILON, center.x), f_max(obj->max.z - 2 * COLLISION_EPSILON, center.y)};
+    obj->cell_min = (v2i){collision_cell(min.x), collision_cell(min.y)};
+    obj->cell_max = (v2i){collision_cell(max.x), collision_cell(max.y)};
+
+    if (!world->objects) {
+        world->cell_min = obj->cell_min;
+        world->cell_max = obj->cell_max;
+    } else {
+        world->cell_min = (v2i){i_min(world->cell_min.x, obj->cell_min.x), i_min(world->cell_min.y, obj->cell_min.y)};
+        world->cell_max = (v2i){i_max(world->cell_max.x, obj->cell_max.x), i_max(world->cell_max.y, obj->cell_max.y)};
+    }
+
     obj->next = world->objects;
     world->objects = obj;
+
+    // Every grid cell is visited at most once, even for huge objects
+    i32 max_x = i_min(obj->cell_max.x, obj->cell_min.x + COLLISION_GRID_SIZE - 1);
+    i32 max_z = i_min(obj->cell_max.y, obj->cell_min.y + COLLISION_GRID_SIZE - 1);
+    for (i32 z = obj->cell_min.y; z <= max_z; ++z) {
+        for (i32 x = obj->cell_min.x; x <= max_x; ++x) {
+            Collision_Link **cell = collision_grid(world, (v2i){x, z});
+            Collision_Link *link = pool_struct(&world->link_pool, Collision_Link);
+            link->obj = obj;
+            link->next = *cell;
+            *cell = link;
+        }
+    }
+}
+
+// ==== Box query ====
+//
+// Iterate over all objects that might overlap a box, every object is returned once.
+// The grid only looks at the xz plane.
+//
+//   Collision_Box box = collision_box(world, min, max);
+//   Collision_Object *obj;
+//   while ((obj = collision_box_next(&box))) { ... }
+typedef struct {
+    Collision_World *world;
+    v3 min;
+    v3 max;
+    Collision_Bvh_Iter bvh;
+
+    // Grid cells to visit (inclusive)
+    v2i cell_min;
+    v2i cell_max;
+
+    // Current cell and the next object in it
+    v2i cell;
+    Collision_Link *link;
+} Collision_Box;
+
+static Collision_Box collision_box(Collision_World *world, v3 min, v3 max) {
+    Collision_Box box = {.world = world, .min = min, .max = max};
+    box.bvh = collision_bvh_iter(world->bvh);
+    if (!world->objects) return box;
+
+    // Only cells with objects
+    box.cell_min = (v2i){i_max(collision_cell(min.x), world->cell_min.x), i_max(collision_cell(min.z), world->cell_min.y)};
+    box.cell_max = (v2i){i_min(collision_cell(max.x), world->cell_max.x), i_min(collision_cell(max.z), world->cell_max.y)};
+    box.cell = (v2i){box.cell_max.x, box.cell_min.y - 1};
+    return box;
+}
+
+// Iterate over all objects that might touch a sphere moving from 'old' to 'new'
+static Collision_Box collision_sphere(Collision_World *world, v3 old, v3 new, f32 radius) {
+    return collision_box(world, v3_min(old, new) - radius, v3_max(old, new) + radius);
+}
+
+static Collision_Object *collision_box_next(Collision_Box *box) {
+    // Static objects
+    Collision_Bvh *bvh = box->world->bvh;
+    Collision_Bvh_Iter *it = &box->bvh;
+    for (;;) {
+        if (it->object < it->object_end) return bvh->objects + it->object++;
+        if (it->stack_count == 0) break;
+
+        u32 node_index = it->stack[--it->stack_count];
+        Collision_Bvh_Node *node = bvh->nodes + node_index;
+        if (!collision_bvh_box_hit(node, box->min, box->max)) continue;
+        if (node->count) {
+            it->object = node->index;
+            it->object_end = node->index + node->count;
+            continue;
+        }
+        collision_bvh_push(it, node->index);
+        collision_bvh_push(it, node_index + 1);
+    }
+
+    // Grid
+    for (;;) {
+        while (box->link) {
+            Collision_Object *obj = box->link->obj;
+            box->link = box->link->next;
+
+            // In this cell because the grid wraps around
+            if (obj->cell_max.x < box->cell_min.x || obj->cell_min.x > box->cell_max.x) continue;
+            if (obj->cell_max.y < box->cell_min.y || obj->cell_min.y > box->cell_max.y) continue;
+
+            // Objects in multiple cells are only returned from the first cell that is part of the box
+            if (box->cell.x != i_max(obj->cell_min.x, box->cell_min.x)) continue;
+            if (box->cell.y != i_max(obj->cell_min.y, box->cell_min.y)) continue;
+            return obj;
+        }
+
+        // Next cell
+        if (!box->world->objects) return 0;
+        box->cell.x++;
+        if (box->cell.x > box->cell_max.x) {
+            box->cell.x = box->cell_min.x;
+            box->cell.y++;
+        }
+        if (box->cell.x > box->cell_max.x || box->cell.y > box->cell_max.y) return 0;
+        box->link = *collision_grid(box->world, box->cell);
+    }
+}
+
+// ==== Ray query ====
+//
+// Iterate over all objects that might be hit by a ray.
+// - Static objects are visited first, nearest node first.
+//   Grid cells are visited in the order the ray crosses them.
+// - Only objects that can be hit before 'distance' are returned.
+//   Lower 'distance' to the closest hit found so far to stop early.
+// - An object in multiple grid cells can be returned more than once.
+// - Distances are measured in units of 'dir'.
+//
+//   Collision_Ray ray = collision_ray(world, pos, dir, max_distance);
+//   Collision_Object *obj;
+//   while ((obj = collision_ray_next(&ray))) { ... ray.distance = hit_distance; }
+typedef struct {
+    Collision_World *world;
+    v3 pos;
+    v3 dir;
+    v3 dir_inv;
+    Collision_Bvh_Iter bvh;
+
+    // Stop at this distance along the ray
+    f32 distance;
+
+    // Current cell and the next object in it
+    v2i cell;
+    Collision_Link *link;
+
+    // Cell step direction, distance to the next cell border and the distance between borders
+    v2i step;
+    v2 next;
+    v2 delta;
+
+    // Distance where the ray leaves all cells that contain objects
+    f32 end;
+
+    // COLLISION_EPSILON along the ray
+    f32 epsilon;
+} Collision_Ray;
+
+static Collision_Ray collision_ray(Collision_World *world, v3 pos, v3 dir, f32 distance) {
+    // No grid cells are visited until 'end' is set
+    Collision_Ray ray = {.world = world, .pos = pos, .dir = dir, .distance = distance, .end = -1};
+    ray.dir_inv = 1.0f / dir;
+    ray.bvh = collision_bvh_iter(world->bvh);
+    if (!world->objects) return ray;
+
+    v2 p = pos.xz;
+    v2 d = dir.xz;
+    v2 bound_min = (v2i_to_v2(world->cell_min) - 0.5f) * COLLISION_CELL_SIZE;
+    v2 bound_max = (v2i_to_v2(world->cell_max) + 0.5f) * COLLISION_CELL_SIZE;
+
+    // Clip the ray to the cells that contain objects
+    f32 start = 0;
+    f32 end = distance;
+    for (u32 i = 0; i < 2; ++i) {
+        if (d[i] == 0) {
+            if (p[i] < bound_min[i] || p[i] > bound_max[i]) return ray;
+            continue;
+        }
+        f32 t0 = (bound_min[i] - p[i]) / d[i];
+        f32 t1 = (bound_max[i] - p[i]) / d[i];
+        start = f_max(start, f_min(t0, t1));
+        end = f_min(end, f_max(t0, t1));
+    }
+    if (start > end) return ray;
+
+    v2 p_start = p + d * start;
+    ray.cell = (v2i){collision_cell(p_start.x), collision_cell(p_start.y)};
+    ray.cell = (v2i){i_min(i_max(ray.cell.x, world->cell_min.x), world->cell_max.x), i_min(i_max(ray.cell.y, world->cell_min.y), world->cell_max.y)};
+
+    for (u32 i = 0; i < 2; ++i) {
+        f32 border = (f32)ray.cell[i] * COLLISION_CELL_SIZE;
+        if (d[i] > 0) {
+            ray.step[i] = 1;
+            ray.next[i] = (border + COLLISION_CELL_SIZE / 2 - p[i]) / d[i];
+            ray.delta[i] = COLLISION_CELL_SIZE / d[i];
+        } else if (d[i] < 0) {
+            ray.step[i] = -1;
+            ray.next[i] = (border - COLLISION_CELL_SIZE / 2 - p[i]) / d[i];
+            ray.delta[i] = -COLLISION_CELL_SIZE / d[i];
+        } else {
+            ray.step[i] = 0;
+            ray.next[i] = INF;
+            ray.delta[i] = INF;
+        }
+    }
+
+    f32 d_len = v2_length(d);
+    ray.epsilon = d_len > 0 ? COLLISION_EPSILON / d_len : INF;
+    ray.end = end;
+    ray.link = *collision_grid(world, ray.cell);
+    return ray;
+}
+
+static Collision_Object *collision_ray_next(Collision_Ray *ray) {
+    // Static objects
+    Collision_Bvh *bvh = ray->world->bvh;
+    Collision_Bvh_Iter *it = &ray->bvh;
+    for (;;) {
+        if (it->object < it->object_end) return bvh->objects + it->object++;
+        if (it->stack_count == 0) break;
+
+        u32 node_index = it->stack[--it->stack_count];
+        Collision_Bvh_Node *node = bvh->nodes + node_index;
+        if (!collision_bvh_ray_hit(node, ray->pos, ray->dir_inv, ray->distance)) continue;
+        if (node->count) {
+            it->object = node->index;
+            it->object_end = node->index + node->count;
+            continue;
+        }
+
+        // Visit the near child first
+        if (ray->dir[node->axis] < 0) {
+            collision_bvh_push(it, node_index + 1);
+            collision_bvh_push(it, node->index);
+        } else {
+            collision_bvh_push(it, node->index);
+            collision_bvh_push(it, node_index + 1);
+        }
+    }
+
+    // Grid
+    for (;;) {
+        while (ray->link) {
+            Collision_Object *obj = ray->link->obj;
+            ray->link = ray->link->next;
+
+            // In this cell because the grid wraps around
+            if (!collision_cell_inside(ray->cell, obj->cell_min, obj->cell_max)) continue;
+            return obj;
+        }
+
+        // Objects stick out of their cells by at most COLLISION_EPSILON
+        u32 axis = ray->next.x < ray->next.y ? 0 : 1;
+        f32 t = ray->next[axis];
+        if (t > ray->end) return 0;
+        if (t - ray->epsilon >= ray->distance) return 0;
+
+        ray->cell[axis] += ray->step[axis];
+        ray->next[axis] += ray->delta[axis];
+        if (!collision_cell_inside(ray->cell, ray->world->cell_min, ray->world->cell_max)) return 0;
+        ray->link = *collision_grid(ray->world, ray->cell);
+    }
 }
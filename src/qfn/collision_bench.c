@@ -0,0 +1,145 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// collision_bench.c - Compare the wide ray tests from collision_wide.h against the scalar ones
+//
+// Run with: ./build build src/qfn/collision_bench.c out/collision_bench --release && out/collision_bench
+#include "lib/fmt.h"
+#include "lib/os_main.h"
+#include "lib/rand.h"
+#include "qfn/collision_test.h"
+
+#define BENCH_QUADS 1024
+#define BENCH_RAYS 256
+#define BENCH_ROUNDS 16
+
+// Shotgun spreads, with as many rays per shot as player_update
+#define BENCH_SHOTS 256
+#define BENCH_PELLETS 128
+
+static void bench_print(char *name, u32 rays, u64 time, f32 sum) {
+    f32 seconds = f_max((f32)time / 1e6f, 1e-6f);
+    fmt_ss(G->fmt, "  ", name, ": ");
+    fmt_f(G->fmt, rays / seconds / 1000);
+    fmt_s(G->fmt, " k rays/s (");
+    fmt_f(G->fmt, sum);
+    fmt_s(G->fmt, ")\n");
+}
+
+// Every ray against every quad
+static void bench_quads(Memory *mem) {
+    Rand rng = rand_new(1);
+    Collision_Object *objects = mem_array_zero(mem, Collision_Object, BENCH_QUADS);
+    for (u32 i = 0; i < BENCH_QUADS; ++i) collision_object_init(objects + i, collision_test_quad(&rng), 0, 0, 0);
+    Collision_Quads *quads = collision_quads_new(mem, BENCH_QUADS, objects);
+
+    v3 *ray_pos = mem_array_uninit(mem, v3, BENCH_RAYS);
+    v3 *ray_dir = mem_array_uninit(mem, v3, BENCH_RAYS);
+    for (u32 i = 0; i < BENCH_RAYS; ++i) {
+        ray_pos[i] = (v3){rand_f32(&rng, -12, 12), rand_f32(&rng, -3, 3), rand_f32(&rng, -12, 12)};
+        ray_dir[i] = v3_normalize((v3){rand_f32(&rng, -1, 1), rand_f32(&rng, -1, 1), rand_f32(&rng, -1, 1)});
+    }
+
+    u32 rays = BENCH_ROUNDS * BENCH_RAYS;
+    fmt_su(G->fmt, "Rays against ", BENCH_QUADS, " quads, the sum of the closest distances is in brackets\n");
+
+    f32 sum = 0;
+    u64 t0 = os_time();
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_RAYS; ++i) {
+            f32 distance = 1000;
+            for (u32 j = 0; j < BENCH_QUADS; ++j) {
+                Collide_Result res;
+                if (collide_quad_ray(&res, objects[j].mtx, ray_pos[i], ray_dir[i]) && res.distance < distance) distance = res.distance;
+            }
+            sum += distance;
+        }
+    }
+    bench_print("collide_quad_ray", rays, os_time() - t0, sum);
+
+    sum = 0;
+    t0 = os_time();
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_RAYS; ++i) {
+            f32 distance = 1000;
+            for (u32 j = 0; j < BENCH_QUADS; ++j) {
+                Collide_Result res;
+                if (collide_object_ray(&res, objects + j, ray_pos[i], ray_dir[i]) && res.distance < distance) distance = res.distance;
+            }
+            sum += distance;
+        }
+    }
+    bench_print("collide_object_ray", rays, os_time() - t0, sum);
+
+    sum = 0;
+    t0 = os_time();
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_RAYS; ++i) {
+            Collide_Result res = {.distance = 1000};
+            collision_quads_ray(quads, ray_pos[i], ray_dir[i], false, &res);
+            sum += res.distance;
+        }
+    }
+    bench_print("collision_quads_ray", rays, os_time() - t0, sum);
+
+    sum = 0;
+    t0 = os_time();
+    for (u32 round = 0; round < BENCH_ROUNDS; ++round) {
+        for (u32 i = 0; i < BENCH_RAYS; i += 8) {
+            Collision_Ray8 packet = collision_ray8(8, ray_pos + i, ray_dir + i);
+            f32x8 dist = (f32x8){} + 1000;
+            f32x8 u = {};
+            f32x8 v = {};
+            for (u32 j = 0; j < BENCH_QUADS; ++j) collision_ray8_object(&packet, objects + j, &dist, &u, &v);
+            for (u32 lane = 0; lane < 8; ++lane) sum += dist[lane];
+        }
+    }
+    bench_print("collision_ray8_object", rays, os_time() - t0, sum);
+}
+
+// Shotgun spreads through a world with walls in a BVH and objects in the grid, like player_shoot_trace
+static void bench_world(Memory *mem) {
+    Rand rng = rand_new(2);
+    Collision_Object *walls = mem_array_zero(mem, Collision_Object, BENCH_QUADS);
+    for (u32 i = 0; i < BENCH_QUADS; ++i) collision_object_init(walls + i, collision_test_quad(&rng), 0, 0, 0);
+    Collision_World *world = collision_world_new(mem, collision_bvh_new(mem, BENCH_QUADS, walls));
+    collision_world_begin(world);
+    for (u32 i = 0; i < 64; ++i) collision_add(world, collision_test_quad(&rng), 0, 1, 0);
+
+    u32 rays = BENCH_SHOTS * BENCH_PELLETS;
+    v3 *ray_pos = mem_array_uninit(mem, v3, rays);
+    v3 *ray_dir = mem_array_uninit(mem, v3, rays);
+    for (u32 shot = 0; shot < BENCH_SHOTS; ++shot) {
+        v3 pos = (v3){rand_f32(&rng, -12, 12), rand_f32(&rng, -3, 3), rand_f32(&rng, -12, 12)};
+        v3 aim = v3_normalize((v3){rand_f32(&rng, -1, 1), rand_f32(&rng, -.2, .2), rand_f32(&rng, -1, 1)});
+        for (u32 i = 0; i < BENCH_PELLETS; ++i) {
+            ray_pos[shot * BENCH_PELLETS + i] = pos;
+            ray_dir[shot * BENCH_PELLETS + i] = aim + (v3){rand_f32(&rng, -.06, .06), rand_f32(&rng, -.06, .06), rand_f32(&rng, -.06, .06)};
+        }
+    }
+
+    fmt_su(G->fmt, "Shotgun spreads of ", BENCH_PELLETS, " rays through a world with a BVH\n");
+
+    f32 sum = 0;
+    u64 t0 = os_time();
+    for (u32 i = 0; i < rays; ++i) sum += collision_test_world_closest(world, ray_pos[i], ray_dir[i], false);
+    bench_print("collision_ray", rays, os_time() - t0, sum);
+
+    sum = 0;
+    t0 = os_time();
+    for (u32 i = 0; i < rays; i += 8) {
+        Collision_Object *hit_obj[8] = {};
+        Collide_Result res[8];
+        for (u32 lane = 0; lane < 8; ++lane) res[lane] = (Collide_Result){.distance = 1000};
+        collision_ray8_world(world, ray_pos + i, ray_dir + i, false, hit_obj, res);
+        for (u32 lane = 0; lane < 8; ++lane) sum += res[lane].distance;
+    }
+    bench_print("collision_ray8_world", rays, os_time() - t0, sum);
+}
+
+static void os_main(void) {
+    Memory *mem = mem_new();
+    bench_quads(mem);
+    bench_world(mem);
+    mem_free(mem);
+    fmt_flush(G->fmt);
+    os_exit(0);
+}
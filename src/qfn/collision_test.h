@@ -0,0 +1,165 @@
+#pragma once
+#include "lib/rand.h"
+#include "lib/test.h"
+#include "qfn/collision_wide.h"
+
+// Random quad in a 20x20 area
+static m4 collision_test_quad(Rand *rng) {
+    m4 mtx = m4_id();
+    m4_scale(&mtx, (v3){rand_f32(rng, 0.2, 3), rand_f32(rng, 0.2, 3), 1});
+    m4_rotate_x(&mtx, rand_f32(rng, -PI, PI));
+    m4_rotate_y(&mtx, rand_f32(rng, -PI, PI));
+    m4_translate(&mtx, (v3){rand_f32(rng, -10, 10), rand_f32(rng, -2, 2), rand_f32(rng, -10, 10)});
+    return mtx;
+}
+
+// Closest hit with the scalar test, returns the distance
+static f32 collision_test_closest(u32 count, Collision_Object *objects, v3 pos, v3 dir, bool cached) {
+    f32 distance = 1000;
+    for (u32 i = 0; i < count; ++i) {
+        Collide_Result res;
+        bool hit = cached ? collide_object_ray(&res, objects + i, pos, dir) : collide_quad_ray(&res, objects[i].mtx, pos, dir);
+        if (hit && res.distance < distance) distance = res.distance;
+    }
+    return distance;
+}
+
+// Compare the wide tests against collide_quad_ray.
+// Rounding can differ at the edge of a quad, so distances are compared with a small tolerance.
+static void collision_wide_test(Test *test) {
+    Rand rng = rand_new(2);
+
+    u32 quad_count = 1024;
+    Collision_Object *objects = mem_array_zero(test->mem, Collision_Object, quad_count);
+    for (u32 i = 0; i < quad_count; ++i) collision_object_init(objects + i, collision_test_quad(&rng), 0, 0, 0);
+    Collision_Quads *quads = collision_quads_new(test->mem, quad_count, objects);
+
+    u32 ray_count = 256;
+    v3 *ray_pos = mem_array_uninit(test->mem, v3, ray_count);
+    v3 *ray_dir = mem_array_uninit(test->mem, v3, ray_count);
+    f32 *want = mem_array_uninit(test->mem, f32, ray_count);
+    for (u32 i = 0; i < ray_count; ++i) {
+        ray_pos[i] = (v3){rand_f32(&rng, -12, 12), rand_f32(&rng, -3, 3), rand_f32(&rng, -12, 12)};
+        ray_dir[i] = v3_normalize((v3){rand_f32(&rng, -1, 1), rand_f32(&rng, -1, 1), rand_f32(&rng, -1, 1)});
+        want[i] = collision_test_closest(quad_count, objects, ray_pos[i], ray_dir[i], false);
+    }
+
+    // One ray against all quads
+    bool quads_ok = true;
+    bool cached_ok = true;
+    u32 hit_count = 0;
+    for (u32 i = 0; i < ray_count; ++i) {
+        Collide_Result res = {.distance = 1000};
+        u32 index = collision_quads_ray(quads, ray_pos[i], ray_dir[i], false, &res);
+        quads_ok &= f_abs(res.distance - want[i]) < 1e-3f;
+        quads_ok &= index == U32_MAX || v3_distance_sq(res.pos, ray_pos[i] + ray_dir[i] * want[i]) < 1e-3f;
+        cached_ok &= f_abs(collision_test_closest(quad_count, objects, ray_pos[i], ray_dir[i], true) - want[i]) < 1e-3f;
+        hit_count += index != U32_MAX;
+    }
+    TEST(quads_ok);
+    TEST(cached_ok);
+    TEST(hit_count > 0);
+
+    // 8 rays against every quad
+    bool ray8_ok = true;
+    for (u32 i = 0; i < ray_count; i += 8) {
+        Collision_Ray8 rays = collision_ray8(8, ray_pos + i, ray_dir + i);
+        f32x8 dist = (f32x8){} + 1000;
+        f32x8 u = {};
+        f32x8 v = {};
+        for (u32 j = 0; j < quad_count; ++j) collision_ray8_object(&rays, objects + j, &dist, &u, &v);
+        for (u32 lane = 0; lane < 8; ++lane) ray8_ok &= f_abs(dist[lane] - want[i + lane]) < 1e-3f;
+    }
+    TEST(ray8_ok);
+
+    // 4 rays against every quad, with the 4 wide kernel
+    bool ray4_ok = true;
+    for (u32 i = 0; i < ray_count; i += 4) {
+        f32x4 p[3], d[3];
+        for (u32 r = 0; r < 3; ++r) {
+            for (u32 lane = 0; lane < 4; ++lane) {
+                p[r][lane] = ray_pos[i + lane][r];
+                d[r][lane] = ray_dir[i + lane][r];
+            }
+        }
+
+        f32x4 closest = (f32x4){} + 1000;
+        for (u32 j = 0; j < quad_count; ++j) {
+            v3 columns[4] = {objects[j].inv.x, objects[j].inv.y, objects[j].inv.z, objects[j].inv.w};
+            f32x4 m[4][3];
+            for (u32 c = 0; c < 4; ++c) {
+                for (u32 r = 0; r < 3; ++r) m[c][r] = (f32x4){} + columns[c][r];
+            }
+            f32x4 u, v;
+            f32x4 dist = collide_quad_ray_4(m, p, d, &u, &v);
+            for (u32 lane = 0; lane < 4; ++lane) closest[lane] = f_min(closest[lane], dist[lane]);
+        }
+        for (u32 lane = 0; lane < 4; ++lane) ray4_ok &= f_abs(closest[lane] - want[i + lane]) < 1e-3f;
+    }
+    TEST(ray4_ok);
+}
+
+// Closest hit through the world with the scalar test, returns the distance
+// With 'opaque' set, hits on transparent pixels are skipped.
+static f32 collision_test_world_closest(Collision_World *world, v3 pos, v3 dir, bool opaque) {
+    Collide_Result best = {.distance = 1000};
+    Collision_Ray ray = collision_ray(world, pos, dir, best.distance);
+    Collision_Object *obj;
+    while ((obj = collision_ray_next(&ray))) {
+        Collide_Result res;
+        if (!collide_object_ray(&res, obj, pos, dir)) continue;
+        if (opaque && !collision_image_opaque(obj->img, res.uv.x, res.uv.y)) continue;
+        if (res.distance >= best.distance) continue;
+        best = res;
+        ray.distance = res.distance;
+    }
+    return best.distance;
+}
+
+// Compare collision_ray8_world against tracing every ray on its own, for shotgun spreads and unrelated rays
+static void collision_ray8_world_test(Test *test) {
+    Rand rng = rand_new(3);
+
+    // Only the left half of every quad is opaque
+    Image *img = image_new(test->mem, (v2u){2, 1});
+    img->pixels[0] = (v4){1, 1, 1, 1};
+    img->pixels[1] = (v4){1, 1, 1, 0};
+
+    u32 wall_count = 512;
+    Collision_Object *walls = mem_array_zero(test->mem, Collision_Object, wall_count);
+    for (u32 i = 0; i < wall_count; ++i) collision_object_init(walls + i, collision_test_quad(&rng), img, 0, 0);
+    Collision_World *world = collision_world_new(test->mem, collision_bvh_new(test->mem, wall_count, walls));
+    collision_world_begin(world);
+    for (u32 i = 0; i < 64; ++i) collision_add(world, collision_test_quad(&rng), img, 1, 0);
+
+    bool dist_ok = true;
+    bool obj_ok = true;
+    u32 hit_count = 0;
+    for (u32 packet = 0; packet < 128; ++packet) {
+        bool spread = packet % 2 == 0;
+        bool opaque = packet % 4 >= 2;
+        v3 center = (v3){rand_f32(&rng, -12, 12), rand_f32(&rng, -3, 3), rand_f32(&rng, -12, 12)};
+        v3 aim = v3_normalize((v3){rand_f32(&rng, -1, 1), rand_f32(&rng, -.2, .2), rand_f32(&rng, -1, 1)});
+
+        v3 pos[8], dir[8];
+        Collision_Object *hit_obj[8] = {};
+        Collide_Result res[8];
+        for (u32 lane = 0; lane < 8; ++lane) {
+            pos[lane] = spread ? center : (v3){rand_f32(&rng, -12, 12), rand_f32(&rng, -3, 3), rand_f32(&rng, -12, 12)};
+            dir[lane] = spread ? aim + (v3){rand_f32(&rng, -.06, .06), rand_f32(&rng, -.06, .06), rand_f32(&rng, -.06, .06)}
+                               : v3_normalize((v3){rand_f32(&rng, -1, 1), rand_f32(&rng, -1, 1), rand_f32(&rng, -1, 1)});
+            res[lane] = (Collide_Result){.distance = 1000};
+        }
+
+        collision_ray8_world(world, pos, dir, opaque, hit_obj, res);
+        for (u32 lane = 0; lane < 8; ++lane) {
+            f32 want = collision_test_world_closest(world, pos[lane], dir[lane], opaque);
+            dist_ok &= f_abs(res[lane].distance - want) < 1e-3f;
+            obj_ok &= (hit_obj[lane] != 0) == (res[lane].distance < 1000);
+            hit_count += hit_obj[lane] != 0;
+        }
+    }
+    TEST(dist_ok);
+    TEST(obj_ok);
+    TEST(hit_count > 0);
+}
@@ -0,0 +1,264 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// collision_wide.h - Ray tests against many quads or with many rays at once
+#pragma once
+#include "lib/math.h"
+#include "qfn/collision.h"
+
+// The same test as collide_quad_ray_inv, for 4 or 8 lanes at once.
+// - One ray against many quads: quads in structure of arrays layout (Collision_Quads), the ray is broadcast.
+// - Many rays against one quad: rays in structure of arrays layout (Collision_Ray8), the quad is broadcast.
+// Only the lanes that hit have to be looked at afterwards, for example to sample the image.
+
+// Unaligned views, arena memory is only 16 byte aligned
+typedef f32x4 Collision_Vec4 __attribute__((aligned(4)));
+typedef f32x8 Collision_Vec8 __attribute__((aligned(4)));
+
+// Ray against quad for every lane, the math is the same as collide_quad_ray_inv.
+// - m: inverse quad matrix, m[column][row]
+// - p, d: ray position and direction
+// - dist: distance along the ray, INF where the lane misses
+// - u, v: hit position on the quad in [-0.5, 0.5]
+// Values that are the same for all lanes are broadcast.
+// Compares give 0 or -1 in every lane, so the masks are combined with '&'.
+#define COLLIDE_QUAD_RAY_N(m, p, d, dist, u, v, f32xn, i32xn)                                                                                     \
+    do {                                                                                                                                             \
+        f32xn pos_z = m[0][2] * p[0] + m[1][2] * p[1] + m[2][2] * p[2] + m[3][2];                                                                    \
+        f32xn dir_z = m[0][2] * d[0] + m[1][2] * d[1] + m[2][2] * d[2];                                                                              \
+        f32xn t = pos_z / -dir_z;                                                                                                                    \
+        u = m[0][0] * p[0] + m[1][0] * p[1] + m[2][0] * p[2] + m[3][0] + (m[0][0] * d[0] + m[1][0] * d[1] + m[2][0] * d[2]) * t;                     \
+        v = m[0][1] * p[0] + m[1][1] * p[1] + m[2][1] * p[2] + m[3][1] + (m[0][1] * d[0] + m[1][1] * d[1] + m[2][1] * d[2]) * t;                     \
+        i32xn hit = (pos_z >= 0) & (dir_z <= 0) & (u >= -0.5f) & (u <= 0.5f) & (v >= -0.5f) & (v <= 0.5f);                                          \
+        f32xn miss = (f32xn){} + INF;                                                                                                                \
+        dist = (f32xn)((hit & (i32xn)t) | (~hit & (i32xn)miss));                                                                                     \
+    } while (0)
+
+static f32x4 collide_quad_ray_4(f32x4 m[4][3], f32x4 p[3], f32x4 d[3], f32x4 *u, f32x4 *v) {
+    f32x4 dist, hit_u, hit_v;
+    COLLIDE_QUAD_RAY_N(m, p, d, dist, hit_u, hit_v, f32x4, i32x4);
+    *u = hit_u;
+    *v = hit_v;
+    return dist;
+}
+
+static f32x8 collide_quad_ray_8(f32x8 m[4][3], f32x8 p[3], f32x8 d[3], f32x8 *u, f32x8 *v) {
+    f32x8 dist, hit_u, hit_v;
+    COLLIDE_QUAD_RAY_N(m, p, d, dist, hit_u, hit_v, f32x8, i32x8);
+    *u = hit_u;
+    *v = hit_v;
+    return dist;
+}
+
+// Is any lane set?
+static bool collision_any_8(i32x8 mask) {
+    union {
+        i32x8 mask;
+        u64 bits[4];
+    } u = {mask};
+    return (u.bits[0] | u.bits[1] | u.bits[2] | u.bits[3]) != 0;
+}
+
+// ==== One ray against many quads ====
+
+// 8 quads in structure of arrays layout, only the inverse matrix is needed.
+// Unused lanes are zero, which never hits.
+typedef struct {
+    Collision_Vec8 m[4][3];
+} Collision_Quad8;
+
+typedef struct {
+    u32 count;
+    Collision_Quad8 *blocks;
+
+    // Object of every quad
+    Collision_Object *objects;
+} Collision_Quads;
+
+// Quads for 'count' objects, for example the walls in Collision_Bvh
+static Collision_Quads *collision_quads_new(Memory *mem, u32 count, Collision_Object *objects) {
+    Collision_Quads *quads = mem_struct(mem, Collision_Quads);
+    quads->count = count;
+    quads->objects = objects;
+    quads->blocks = mem_array_zero(mem, Collision_Quad8, (count + 7) / 8);
+    for (u32 i = 0; i < count; ++i) {
+        Collision_Quad8 *block = quads->blocks + i / 8;
+        m4 inv = objects[i].inv;
+        v3 columns[4] = {inv.x, inv.y, inv.z, inv.w};
+        for (u32 c = 0; c < 4; ++c) {
+            for (u32 r = 0; r < 3; ++r) block->m[c][r][i % 8] = columns[c][r];
+        }
+    }
+    return quads;
+}
+
+// Closest hit of one ray against all quads, nearer than 'res->distance'.
+// Returns the index of the hit quad and fills 'res', or returns U32_MAX if nothing was hit.
+// With 'opaque' set, hits on transparent pixels are skipped.
+static u32 collision_quads_ray(Collision_Quads *quads, v3 pos, v3 dir, bool opaque, Collide_Result *res) {
+    f32x8 p[3] = {(f32x8){} + pos.x, (f32x8){} + pos.y, (f32x8){} + pos.z};
+    f32x8 d[3] = {(f32x8){} + dir.x, (f32x8){} + dir.y, (f32x8){} + dir.z};
+
+    u32 hit_index = U32_MAX;
+    u32 block_count = (quads->count + 7) / 8;
+    for (u32 b = 0; b < block_count; ++b) {
+        Collision_Quad8 *block = quads->blocks + b;
+        f32x8 m[4][3];
+        for (u32 c = 0; c < 4; ++c) {
+            for (u32 r = 0; r < 3; ++r) m[c][r] = block->m[c][r];
+        }
+
+        f32x8 u, v;
+        f32x8 dist = collide_quad_ray_8(m, p, d, &u, &v);
+        if (!collision_any_8(dist < res->distance)) continue;
+
+        // Usually only a few lanes are left
+        for (u32 lane = 0; lane < 8; ++lane) {
+            if (!(dist[lane] < res->distance)) continue;
+            u32 index = b * 8 + lane;
+            if (opaque && !collision_image_opaque(quads->objects[index].img, u[lane], v[lane])) continue;
+            res->pos = pos + dir * dist[lane];
+            res->uv = (v2){u[lane], v[lane]};
+            res->distance = dist[lane];
+            hit_index = index;
+        }
+    }
+    return hit_index;
+}
+
+// ==== Many rays against one quad ====
+
+// 8 rays in structure of arrays layout
+typedef struct {
+    f32x8 pos[3];
+    f32x8 dir[3];
+} Collision_Ray8;
+
+// Pack up to 8 rays, unused lanes have no direction and never hit
+static Collision_Ray8 collision_ray8(u32 count, v3 *pos, v3 *dir) {
+    Collision_Ray8 rays = {};
+    for (u32 i = 0; i < count && i < 8; ++i) {
+        for (u32 r = 0; r < 3; ++r) {
+            rays.pos[r][i] = pos[i][r];
+            rays.dir[r][i] = dir[i][r];
+        }
+    }
+    return rays;
+}
+
+// Test 8 rays against one object.
+// Lanes that hit nearer than 'dist' get the new distance and hit position, and are set in the returned mask.
+static i32x8 collision_ray8_object(Collision_Ray8 *rays, Collision_Object *obj, f32x8 *dist, f32x8 *u, f32x8 *v) {
+    m4 inv = obj->inv;
+    v3 columns[4] = {inv.x, inv.y, inv.z, inv.w};
+    f32x8 m[4][3];
+    for (u32 c = 0; c < 4; ++c) {
+        for (u32 r = 0; r < 3; ++r) m[c][r] = (f32x8){} + columns[c][r];
+    }
+
+    f32x8 hit_u, hit_v;
+    f32x8 hit_dist = collide_quad_ray_8(m, rays->pos, rays->dir, &hit_u, &hit_v);
+    i32x8 closer = hit_dist < *dist;
+    *dist = (f32x8)((closer & (i32x8)hit_dist) | (~closer & (i32x8)*dist));
+    *u = (f32x8)((closer & (i32x8)hit_u) | (~closer & (i32x8)*u));
+    *v = (f32x8)((closer & (i32x8)hit_v) | (~closer & (i32x8)*v));
+    return closer;
+}
+
+// ==== Many rays through the world ====
+
+// Does any of the 8 rays hit the node before its 'dist'? Same as collision_bvh_ray_hit for every lane.
+static bool collision_ray8_node(Collision_Bvh_Node *node, Collision_Ray8 *rays, f32x8 dir_inv[3], f32x8 dist) {
+    f32x8 t_enter = {};
+    f32x8 t_exit = dist;
+    for (u32 r = 0; r < 3; ++r) {
+        f32x8 t0 = (node->min[r] - rays->pos[r]) * dir_inv[r];
+        f32x8 t1 = (node->max[r] - rays->pos[r]) * dir_inv[r];
+        i32x8 swap = t1 < t0;
+        f32x8 t_near = (f32x8)((swap & (i32x8)t1) | (~swap & (i32x8)t0));
+        f32x8 t_far = (f32x8)((swap & (i32x8)t0) | (~swap & (i32x8)t1));
+        i32x8 enter = t_near > t_enter;
+        i32x8 exit = t_far < t_exit;
+        t_enter = (f32x8)((enter & (i32x8)t_near) | (~enter & (i32x8)t_enter));
+        t_exit = (f32x8)((exit & (i32x8)t_far) | (~exit & (i32x8)t_exit));
+    }
+    return collision_any_8(t_enter <= t_exit);
+}
+
+// Test 8 rays against one object, and keep the lanes that hit nearer than 'dist'.
+// 'hit' is set to the object for these lanes. With 'opaque' set, hits on transparent pixels are skipped.
+static void collision_ray8_hit(Collision_Ray8 *rays, Collision_Object *obj, bool opaque, f32x8 *dist, f32x8 *u, f32x8 *v, Collision_Object **hit) {
+    f32x8 old_dist = *dist, old_u = *u, old_v = *v;
+    i32x8 closer = collision_ray8_object(rays, obj, dist, u, v);
+    if (!collision_any_8(closer)) return;
+
+    for (u32 i = 0; i < 8; ++i) {
+        if (!closer[i]) continue;
+        if (!opaque || collision_image_opaque(obj->img, (*u)[i], (*v)[i])) {
+            hit[i] = obj;
+            continue;
+        }
+
+        // Transparent, keep the previous hit
+        (*dist)[i] = old_dist[i];
+        (*u)[i] = old_u[i];
+        (*v)[i] = old_v[i];
+    }
+}
+
+// Closest hit of 8 rays through the world, nearer than 'res[i].distance'.
+// Lanes that hit set 'hit_obj[i]' and fill 'res[i]', other lanes are not changed.
+// With 'opaque' set, hits on transparent pixels are skipped.
+//
+// Works best for rays that start close together and point in almost the same direction, like a shotgun spread.
+// - The static BVH is walked once for all 8 rays. A node is visited if any ray hits it.
+// - The grid is walked for every ray on its own, but the objects it finds are tested against all 8 rays.
+//   The next rays start with the closest hit found so far, so they stop early.
+static void collision_ray8_world(Collision_World *world, v3 *pos, v3 *dir, bool opaque, Collision_Object **hit_obj, Collide_Result *res) {
+    Collision_Ray8 rays = collision_ray8(8, pos, dir);
+    f32x8 dir_inv[3] = {1.0f / rays.dir[0], 1.0f / rays.dir[1], 1.0f / rays.dir[2]};
+    f32x8 dist, u, v;
+    for (u32 lane = 0; lane < 8; ++lane) {
+        dist[lane] = res[lane].distance;
+        u[lane] = res[lane].uv.x;
+        v[lane] = res[lane].uv.y;
+    }
+    f32x8 start_dist = dist;
+
+    // Static objects, the near child of the first ray is visited first
+    Collision_Bvh *bvh = world->bvh;
+    Collision_Bvh_Iter it = collision_bvh_iter(bvh);
+    while (it.stack_count) {
+        u32 node_index = it.stack[--it.stack_count];
+        Collision_Bvh_Node *node = bvh->nodes + node_index;
+        if (!collision_ray8_node(node, &rays, dir_inv, dist)) continue;
+        if (node->count) {
+            for (u32 i = 0; i < node->count; ++i) collision_ray8_hit(&rays, bvh->objects + node->index + i, opaque, &dist, &u, &v, hit_obj);
+            continue;
+        }
+
+        if (dir[0][node->axis] < 0) {
+            collision_bvh_push(&it, node_index + 1);
+            collision_bvh_push(&it, node->index);
+        } else {
+            collision_bvh_push(&it, node->index);
+            collision_bvh_push(&it, node_index + 1);
+        }
+    }
+
+    // Grid, without the static objects
+    for (u32 lane = 0; world->objects && lane < 8; ++lane) {
+        Collision_Ray ray = collision_ray(world, pos[lane], dir[lane], dist[lane]);
+        ray.bvh = (Collision_Bvh_Iter){};
+        Collision_Object *obj;
+        while ((obj = collision_ray_next(&ray))) {
+            collision_ray8_hit(&rays, obj, opaque, &dist, &u, &v, hit_obj);
+            ray.distance = dist[lane];
+        }
+    }
+
+    for (u32 lane = 0; lane < 8; ++lane) {
+        if (dist[lane] == start_dist[lane]) continue;
+        res[lane].pos = pos[lane] + dir[lane] * dist[lane];
+        res[lane].uv = (v2){u[lane], v[lane]};
+        res[lane].distance = dist[lane];
+    }
+}
@@ -2,6 +2,7 @@
 // game.h - Game data structures and implementation
 #pragma once
 #include "lib/mem.h"
+#include "lib/mem_stats.h"
 #include "lib/rand.h"
 #include "lib/types.h"
 #include "lib/vec.h"
@@ -20,10 +21,14 @@ typedef struct {
     Player *player;
     Monster *monster_list;
     Level2 *level;
+    Collision_World *world;
 
     bool debug;
     Audio audio;
 
+    // Duration of the last game_update in micro seconds
+    u64 update_time;
+
     f32 time;
 } Game;
 
@@ -64,6 +69,7 @@ static Game *game_new(Rand *rng) {
     v2i level_size = {12, 12};
 
     Memory *mem = mem_new();
+    mem_set_name(mem, "game");
     Game *game = mem_struct(mem, Game);
     game->mem = mem;
     game->level = level_generate(mem, rng, level_size);
@@ -71,22 +77,34 @@ static Game *game_new(Rand *rng) {
     v3 spawn = v3i_to_v3(game->level->spawn);
     game->monster_list = game_gen_monsters(mem, game->level->walls, rng, spawn);
     game->player = player_new(game->mem, spawn);
-    game->audio.snd = sound_init(mem);
+
+    // Sound variables are allocated from the audio thread, so they get their own arena
+    Memory *sound_mem = mem_new();
+    mem_set_name(sound_mem, "sound");
+    audio_init(&game->audio, sound_mem);
+    game->world = collision_world_new(mem, game->level->bvh);
     return game;
 }
 
+// Free a game and all its memory
+static void game_free(Game *game) {
+    mem_free(game->audio.snd.imm.mem);
+    mem_free(game->mem);
+}
+
 static void game_update(Game *game, Engine *eng) {
-    Collision_World *world = collision_world_new(G->tmp);
+    Collision_World *world = game->world;
+    collision_world_begin(world);
 
     for (Wall *wall = game->level->walls; wall; wall = wall->next) {
-        wall_update(wall, eng, world);
+        wall_update(wall, eng);
     }
 
     u32 player_damage = 0;
     u32 alive_count = 0;
     u32 dead_count = 0;
     for (Monster *mon = game->monster_list; mon; mon = mon->next) {
-        monster_update(mon, eng, &game->audio, world, game->player->pos, &player_damage);
+        monster_update(mon, eng, &game->audio, game->level->maze, world, game->player->pos, &player_damage);
         if (mon->state != Monster_State_Dead) {
             alive_count++;
         } else {
@@ -97,16 +115,16 @@ static void game_update(Game *game, Engine *eng) {
     bool over = game->player->health == 0 && alive_count > 0;
     bool win = alive_count == 0;
 
-    mutex_lock(&game->audio.mutex);
-    game->audio.over = over;
-    game->audio.win = win;
-    mutex_unlock(&game->audio.mutex);
+    audio_state(&game->audio, over, win);
 
     if (input_toggle(eng->input, KEY_4, &game->debug)) {
         m4 mtx = m4_id();
         m4_translate(&mtx, (v3){0, -20, 0});
         m4_scale(&mtx, .5);
         m4_translate(&mtx, (v3){-eng->input->window_size.x / 2, eng->input->window_size.y / 2, 0});
+        // Cycle page type for new slabs, restart the level with 'R' to measure the effect
+        if (input_click(eng->input, KEY_5)) G->chunk_pages = (G->chunk_pages + 1) % (OS_Pages_Huge + 1);
+
         Fmt *fmt = fmt_new(G->tmp, 0);
         fmt_s(fmt, " Alloc ");
         fmt_u(fmt, G->stat_alloc_size / 1024 / 1024);
@@ -114,9 +132,45 @@ static void game_update(Game *game, Engine *eng) {
         fmt_s(fmt, " Cache ");
         fmt_u(fmt, G->stat_cache_size / 1024 / 1024);
         fmt_s(fmt, " M\n");
+        fmt_s(fmt, " Trim  ");
+        fmt_u(fmt, G->stat_trim_size / 1024 / 1024);
+        fmt_s(fmt, " M\n");
+        fmt_s(fmt, " Res   ");
+        fmt_u(fmt, (G->stat_alloc_size - G->stat_trim_size) / 1024 / 1024);
+        fmt_s(fmt, " M\n");
+        fmt_s(fmt, " Maps  ");
+        fmt_u(fmt, G->stat_map_count);
+        fmt_s(fmt, "\n");
+        fmt_s(fmt, " Huge  ");
+        fmt_u(fmt, G->stat_huge_size / 1024 / 1024);
+        fmt_s(fmt, " M\n");
+        fmt_s(fmt, " THP   ");
+        fmt_u(fmt, G->stat_thp_size / 1024 / 1024);
+        fmt_s(fmt, " M\n");
+        fmt_s(fmt, " Pages ");
+        if (G->chunk_pages == OS_Pages_Normal) fmt_s(fmt, "Normal");
+        if (G->chunk_pages == OS_Pages_Transparent) fmt_s(fmt, "Transparent");
+        if (G->chunk_pages == OS_Pages_Huge) fmt_s(fmt, "Huge");
+        fmt_s(fmt, " (5)\n");
         fmt_s(fmt, " Skips ");
         fmt_u(fmt, G->frame_skips);
         fmt_s(fmt, "\n");
+        fmt_s(fmt, " Update ");
+        fmt_u(fmt, game->update_time);
+        fmt_s(fmt, " us\n");
+
+        // Events sent to the audio thread
+        fmt_s(fmt, " Audio ");
+        fmt_u(fmt, game->audio.stat_events);
+        fmt_s(fmt, " events, ");
+        fmt_u(fmt, game->audio.stat_dropped);
+        fmt_s(fmt, " dropped\n");
+        fmt_s(fmt, "\n");
+        mem_stats_fmt(fmt);
+        fmt_s(fmt, " Print (6)\n");
+
+        // Dump the memory table to stdout
+        if (input_click(eng->input, KEY_6)) mem_stats_print();
         ui_text(eng->ui, mtx, fmt_close(fmt));
     }
 
@@ -14,8 +14,10 @@
 
 TYPEDEF_STRUCT(Level2);
 struct Level2 {
+    // Maze the walls are generated from, used for line of sight
     Maze *maze;
     Wall *walls;
+    Collision_Bvh *bvh;
     v3i spawn;
 };
 
@@ -64,7 +66,7 @@ static Level2 *level_generate(Memory *mem, Rand *rng, v2i size) {
     // Generate maze
     u32 maze_sx = size.x * 2 + 1;
     u32 maze_sy = size.y * 2 + 1;
-    Maze *maze = maze_new(G->tmp, maze_sx, maze_sy);
+    Maze *maze = maze_new(mem, maze_sx, maze_sy);
     maze_init_circle(maze, 1.0, 0.0);
     maze_generate(maze, rng);
     maze_remove_walls(maze, rng, 0.2);
@@ -87,8 +89,8 @@ static Level2 *level_generate(Memory *mem, Rand *rng, v2i size) {
         }
     }
 
-    for (i32 y = 1; y < maze_sx; y += 2) {
-        for (i32 x = 1; x < maze_sy; x += 2) {
+    for (i32 y = 1; y < maze_sy; y += 2) {
+        for (i32 x = 1; x < maze_sx; x += 2) {
             Maze_Cell cell = maze_get(maze, x, y);
             if (cell != Maze_Cell_Inside) continue;
 
@@ -125,5 +127,6 @@ static Level2 *level_generate(Memory *mem, Rand *rng, v2i size) {
             level_add_wall(mem, level, floor, wall_pos, mtx_zp);
         }
     }
+    level->bvh = wall_bvh_new(mem, level->walls);
     return level;
 }
@@ -3,6 +3,7 @@
 #include "gfx/gfx.h"
 #include "gfx/input.h"
 #include "lib/global.h"
+#include "lib/job.h"
 #include "lib/math.h"
 #include "lib/os_main.h"
 #include "qfn/engine.h"
@@ -28,7 +29,11 @@ static App *app_load(void) {
         return G->app;
     }
 
+    // Start one worker thread per core
+    job_init(0);
+
     Memory *mem = mem_new();
+    mem_set_name(mem, "app");
     App *app = mem_struct(mem, App);
     app->mem = mem;
     app->eng = engine_new(mem, *G->rand, "Quest For Nothing");
@@ -41,11 +46,11 @@ static App *app_load(void) {
 static void gfx_audio_callback(u32 sample_count, v2 *samples) {
     App *app = AUDIO_CALLBACK_STATE;
     Audio *audio = &app->game->audio;
-    mutex_lock(&audio->mutex);
+    audio_block_begin(audio, sample_count);
+    audio_render(audio, sample_count, samples);
     for (u32 i = 0; i < sample_count; ++i) {
-        samples[i] = sound_clip2(audio_sample(audio));
+        samples[i] = sound_clip2(samples[i]);
     }
-    mutex_unlock(&audio->mutex);
 }
 
 static void os_main(void) {
@@ -61,7 +66,7 @@ static void os_main(void) {
 
     // Basic input
     if (input->quit || (input_click(input, KEY_Q) && input_down(input, KEY_SHIFT))) os_exit(0);
-    input_toggle(input, KEY_M, &game->audio.mute);
+    if (input_click(input, KEY_M)) audio_mute(&game->audio, !game->audio.mute);
 
     // Toggle fullscreen
     if (input_click(input, KEY_F)) {
@@ -70,12 +75,14 @@ static void os_main(void) {
 
     // Reload level with 'R'
     if (input_click(input, KEY_R)) {
-        Memory *old = app->game->mem;
+        Game *old = app->game;
         app->game = game_new(&eng->rng);
-        mem_free(old);
+        game_free(old);
     }
 
+    u64 update_start = os_time();
     game_update(game, eng);
+    game->update_time = os_time() - update_start;
 
     // Graphics
     engine_end(app->eng, (v3){0.02, 0.02, 0.02}, game->player->camera);
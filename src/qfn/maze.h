@@ -36,7 +36,7 @@ static Maze_Cell maze_get(Maze *maze, i32 x, i32 y) {
     if (x < 0) return Maze_Cell_Outside;
     if (y < 0) return Maze_Cell_Outside;
     if (x >= maze->size_x) return Maze_Cell_Outside;
-    if (x >= maze->size_y) return Maze_Cell_Outside;
+    if (y >= maze->size_y) return Maze_Cell_Outside;
     return maze->cells[y * maze->size_x + x];
 }
 
@@ -44,7 +44,7 @@ static void maze_set(Maze *maze, i32 x, i32 y, Maze_Cell value) {
     if (x < 0) return;
     if (y < 0) return;
     if (x >= maze->size_x) return;
-    if (x >= maze->size_y) return;
+    if (y >= maze->size_y) return;
     maze->cells[y * maze->size_x + x] = value;
 }
 
@@ -165,6 +165,50 @@ static void maze_remove_pillars(Maze *maze) {
     }
 }
 
+// Walk the line from 'a' to 'b' through the maze cells, crossing one wall at a time.
+// Positions are in maze coordinates: cell (x, y) with odd x and y covers [x - 1, x + 1] x [y - 1, y + 1],
+// so the walls between cells are at even coordinates.
+// Returns true if every crossed wall is open. Otherwise returns false and the first closed wall
+// together with the cell behind it in 'hit'.
+static bool maze_line(Maze *maze, v2 a, v2 b, Maze_Pos *hit) {
+    i32 x = f_floor(a.x / 2) * 2 + 1;
+    i32 y = f_floor(a.y / 2) * 2 + 1;
+    i32 end_x = f_floor(b.x / 2) * 2 + 1;
+    i32 end_y = f_floor(b.y / 2) * 2 + 1;
+
+    v2 dir = b - a;
+    i32 step_x = dir.x < 0 ? -1 : 1;
+    i32 step_y = dir.y < 0 ? -1 : 1;
+
+    // Fraction of the line to the next wall, and between two walls
+    f32 next_x = dir.x != 0 ? (x + step_x - a.x) / dir.x : INF;
+    f32 next_y = dir.y != 0 ? (y + step_y - a.y) / dir.y : INF;
+    f32 delta_x = dir.x != 0 ? 2 / f_abs(dir.x) : INF;
+    f32 delta_y = dir.y != 0 ? 2 / f_abs(dir.y) : INF;
+
+    // Every step crosses one wall, so this ends in the cell of 'b'
+    u32 steps = i_abs(end_x - x) / 2 + i_abs(end_y - y) / 2;
+    for (u32 i = 0; i < steps; ++i) {
+        Maze_Pos pos;
+        if (next_x < next_y) {
+            pos = (Maze_Pos){x + step_x, y, x + step_x * 2, y};
+            next_x += delta_x;
+        } else {
+            pos = (Maze_Pos){x, y + step_y, x, y + step_y * 2};
+            next_y += delta_y;
+        }
+
+        if (maze_get(maze, pos.wall_x, pos.wall_y) != Maze_Cell_Inside) {
+            *hit = pos;
+            return false;
+        }
+
+        x = pos.cell_x;
+        y = pos.cell_y;
+    }
+    return true;
+}
+
 // Format maze
 static void maze_debug_fmt(Maze *maze, Fmt *f) {
     for (u32 y = 0; y < maze->size_y; ++y) {
@@ -0,0 +1,54 @@
+#pragma once
+#include "lib/rand.h"
+#include "lib/test.h"
+#include "qfn/maze.h"
+
+// Compare maze_line against crossing every closed wall of the maze
+static void maze_line_test(Test *test) {
+    Rand rng = rand_new(3);
+    Maze *maze = maze_new(test->mem, 33, 33);
+    maze_init_circle(maze, 1, 0.2);
+    maze_generate(maze, &rng);
+    maze_remove_walls(maze, &rng, 0.2);
+
+    bool clear_ok = true;
+    bool hit_ok = true;
+    u32 clear_count = 0;
+    for (u32 i = 0; i < 2000; ++i) {
+        v2 a = {rand_f32(&rng, 0, 32), rand_f32(&rng, 0, 32)};
+        v2 b = {rand_f32(&rng, 0, 32), rand_f32(&rng, 0, 32)};
+        if (i % 4 == 0) b = a + (v2){rand_f32(&rng, -3, 3), rand_f32(&rng, -3, 3)};
+        v2 dir = b - a;
+
+        // First closed wall crossed by the line
+        f32 first_t = INF;
+        i32 first_x = 0;
+        i32 first_y = 0;
+        for (i32 y = 0; y < maze->size_y; ++y) {
+            for (i32 x = 0; x < maze->size_x; ++x) {
+                // Walls are between two cells, so one coordinate is even and the other odd
+                if (x % 2 == y % 2) continue;
+                if (maze_get(maze, x, y) == Maze_Cell_Inside) continue;
+
+                // Line position where it crosses the wall, and the position along the wall
+                bool vertical = x % 2 == 0;
+                f32 t = vertical ? (x - a.x) / dir.x : (y - a.y) / dir.y;
+                f32 along = vertical ? a.y + dir.y * t - y : a.x + dir.x * t - x;
+                if (!(t > 0 && t < 1 && f_abs(along) <= 1)) continue;
+                if (t > first_t) continue;
+                first_t = t;
+                first_x = x;
+                first_y = y;
+            }
+        }
+
+        Maze_Pos hit;
+        bool clear = maze_line(maze, a, b, &hit);
+        clear_ok &= clear == (first_t == INF);
+        if (!clear) hit_ok &= hit.wall_x == first_x && hit.wall_y == first_y;
+        clear_count += clear;
+    }
+    TEST(clear_ok);
+    TEST(hit_ok);
+    TEST(clear_count > 0);
+}
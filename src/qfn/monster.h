@@ -8,6 +8,7 @@
 #include "qfn/collision.h"
 #include "qfn/engine.h"
 #include "qfn/gun.h"
+#include "qfn/maze.h"
 #include "qfn/monster_sprite.h"
 #include "qfn/wall.h"
 
@@ -71,7 +72,39 @@ static Monster *monster_new(Memory *mem, v3 pos, Sprite_Properties prop) {
     return mon;
 }
 
-static void monster_update(Monster *mon, Engine *eng, Audio *audio, Collision_World *world, v3 player_pos, u32 *player_damage) {
+// Is there no wall between 'eye' and 'target'?
+// Most lines are answered by walking the maze cells between them.
+// Only walls that face the outside can be windows, there the exact quads are tested and the glass is transparent.
+static bool monster_can_see(Maze *maze, Collision_World *world, v3 eye, v3 target) {
+    // level_generate places maze cell (x, y) at (x - 1, 0, y - 1)
+    v2 a = (v2){eye.x, eye.z} + 1;
+    v2 b = (v2){target.x, target.z} + 1;
+
+    Maze_Pos hit;
+    if (maze_get(maze, f_floor(a.x / 2) * 2 + 1, f_floor(a.y / 2) * 2 + 1) == Maze_Cell_Inside) {
+        if (maze_line(maze, a, b, &hit)) return true;
+        if (maze_get(maze, hit.cell_x, hit.cell_y) != Maze_Cell_Outside) return false;
+    }
+
+    v3 diff = target - eye;
+    f32 dist = v3_length(diff);
+    if (dist <= 0) return true;
+    v3 dir = diff / dist;
+
+    Collision_Ray ray = collision_ray(world, eye, dir, dist);
+    Collision_Object *obj;
+    while ((obj = collision_ray_next(&ray))) {
+        // Only walls
+        if (obj->type != 0) continue;
+        Collide_Result res;
+        if (!collide_object_ray(&res, obj, eye, dir)) continue;
+        if (res.distance >= dist) continue;
+        if (collision_image_opaque(obj->img, res.uv.x, res.uv.y)) return false;
+    }
+    return true;
+}
+
+static void monster_update(Monster *mon, Engine *eng, Audio *audio, Maze *maze, Collision_World *world, v3 player_pos, u32 *player_damage) {
     f32 dt = G->dt;
     Rand *rng = &eng->rng;
 
@@ -99,17 +132,8 @@ static void monster_update(Monster *mon, Engine *eng, Audio *audio, Collision_Wo
 
     // Idle -> Attack
     else if (mon->state == Monster_State_Idle && rand_choice(rng, dt)) {
-        bool can_see = true;
-        for (Collision_Object *obj = world->objects; obj; obj = obj->next) {
-            // Only walls
-            if (obj->type != 0) continue;
-            Collide_Result res;
-            if (collide_quad_ray(&res, obj->mtx, mon->pos + (v3){0, mon->size.y / 2, 0}, player_dir) && res.distance < player_dist) {
-                can_see = false;
-                break;
-            }
-        }
-        if (can_see) mon->state = Monster_State_Attack;
+        v3 eye_pos = mon->pos + (v3){0, mon->size.y / 2, 0};
+        if (monster_can_see(maze, world, eye_pos, player_pos)) mon->state = Monster_State_Attack;
     }
 
     // Attack -> Shoot
@@ -150,12 +174,7 @@ static void monster_update(Monster *mon, Engine *eng, Audio *audio, Collision_Wo
     else if (mon->state == Monster_State_Shoot) {
         if (mon->shoot_timeout == 0 && rand_choice(G->rand, dt)) {
             mon->shoot_timeout = 1.0f;
-            mutex_lock(&audio->mutex);
-            audio->shoot[audio->shoot_ix].active = true;
-            audio->shoot[audio->shoot_ix].pos = m4_mul_pos(audio->inv_mtx, mon->pos);
-            audio->shoot[audio->shoot_ix].freq = sound_scale(rand_u32(G->rand, 4 * 7, 5 * 7));
-            audio->shoot_ix = (audio->shoot_ix + 1) % array_count(audio->shoot);
-            mutex_unlock(&audio->mutex);
+            audio_effect(audio, mon->pos, sound_scale(rand_u32(G->rand, 4 * 7, 5 * 7)));
 
             // for (u32 i = 0; i < 32; ++i) {
             Collide_Result hit_res = {.distance = 1000.0f};
@@ -167,17 +186,16 @@ static void monster_update(Monster *mon, Engine *eng, Audio *audio, Collision_Wo
             // shoot_dir.y += rand_f32(&eng->rng, -1, 1) * 0.02;
             // shoot_dir.z += rand_f32(&eng->rng, -1, 1) * 0.02;
             // shoot_dir = v3_normalize(shoot_dir);
-            for (Collision_Object *obj = world->objects; obj; obj = obj->next) {
+            Collision_Ray ray = collision_ray(world, shoot_pos, shoot_dir, hit_res.distance);
+            Collision_Object *obj;
+            while ((obj = collision_ray_next(&ray))) {
                 Collide_Result res;
-                if (collide_quad_ray(&res, obj->mtx, shoot_pos, shoot_dir)) {
-                    Image *img = obj->img;
-                    v4 *px = image_get(img, (v2i){(res.uv.x + .5) * img->size.x, (.5 - res.uv.y) * img->size.y});
-
-                    if (!px) continue;
-                    if (px->w < .9f) continue;
+                if (collide_object_ray(&res, obj, shoot_pos, shoot_dir)) {
+                    if (!collision_image_opaque(obj->img, res.uv.x, res.uv.y)) continue;
                     if (res.distance > hit_res.distance) continue;
                     hit_obj = obj;
                     hit_res = res;
+                    ray.distance = res.distance;
                 }
             }
 
@@ -236,10 +254,12 @@ static void monster_update(Monster *mon, Engine *eng, Audio *audio, Collision_Wo
     mon->pos += vel * dt;
 
     // Collision
-    for (Collision_Object *obj = world->objects; obj; obj = obj->next) {
+    f32 r = 0.25;
+    v3 offset = {0, r, 0};
+    Collision_Box box = collision_sphere(world, old + offset, mon->pos + offset, r);
+    Collision_Object *obj;
+    while ((obj = collision_box_next(&box))) {
         if (obj->type != 0) continue;
-        f32 r = 0.25;
-        v3 offset = {0, r, 0};
         mon->pos += wall_collide(obj->mtx, r, old + offset, mon->pos + offset);
     }
 
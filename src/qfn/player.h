@@ -2,9 +2,11 @@
 // player.h - The player character
 #pragma once
 #include "gfx/input.h"
+#include "lib/job.h"
 #include "lib/vec.h"
 #include "qfn/audio.h"
 #include "qfn/collision.h"
+#include "qfn/collision_wide.h"
 #include "qfn/engine.h"
 #include "qfn/monster.h"
 #include "qfn/wall.h"
@@ -72,6 +74,42 @@ static Player *player_new(Memory *mem, v3 pos) {
     return player;
 }
 
+// A single ray of the shotgun, they are traced in packets of 8
+typedef struct {
+    v3 pos;
+    v3 dir;
+
+    // Closest opaque hit
+    Collision_Object *hit_obj;
+    Collide_Result hit_res;
+} Player_Shot;
+
+typedef struct {
+    Collision_World *world;
+    Player_Shot *shots;
+} Player_Shoot_Job;
+
+// Trace the shots 'index * 8' to 'index * 8 + 7', this only reads the world, so it can run in parallel
+static void player_shoot_trace(void *data, u32 index) {
+    Player_Shoot_Job *job = data;
+    Player_Shot *shots = job->shots + index * 8;
+
+    v3 pos[8], dir[8];
+    Collision_Object *hit_obj[8] = {};
+    Collide_Result hit_res[8];
+    for (u32 lane = 0; lane < 8; ++lane) {
+        pos[lane] = shots[lane].pos;
+        dir[lane] = shots[lane].dir;
+        hit_res[lane] = (Collide_Result){.distance = 1000.0f};
+    }
+
+    collision_ray8_world(job->world, pos, dir, true, hit_obj, hit_res);
+    for (u32 lane = 0; lane < 8; ++lane) {
+        shots[lane].hit_obj = hit_obj[lane];
+        shots[lane].hit_res = hit_res[lane];
+    }
+}
+
 static void player_update(Player *player, Collision_World *world, Engine *eng, Audio *audio, u32 damage) {
     Player_Input input = player_parse_input(eng->input);
 
@@ -103,10 +141,12 @@ static void player_update(Player *player, Collision_World *world, Engine *eng, A
 
         // Collision
         bool on_ground = 0;
-        for (Collision_Object *obj = world->objects; obj; obj = obj->next) {
+        f32 r = 0.25;
+        v3 offset = {0, r, 0};
+        Collision_Box box = collision_sphere(world, old + offset, player->pos + offset, r);
+        Collision_Object *obj;
+        while ((obj = collision_box_next(&box))) {
             if (obj->type != 0) continue;
-            f32 r = 0.25;
-            v3 offset = {0, r, 0};
             v3 dx = wall_collide(obj->mtx, r, old + offset, player->pos + offset);
             if (dx.y > 0) on_ground = 1;
             player->pos += dx;
@@ -115,7 +155,7 @@ static void player_update(Player *player, Collision_World *world, Engine *eng, A
         // Jumping
         if (input.jump && on_ground) {
             player->pos.y += G->dt * 4;
-            audio->play_jump = 1;
+            audio_jump(audio);
         }
     }
 
@@ -123,9 +163,7 @@ static void player_update(Player *player, Collision_World *world, Engine *eng, A
         player->screen_shake += (f32)damage / 2;
         player->health -= damage;
 
-        mutex_lock(&audio->mutex);
-        audio->play_hurt = true;
-        mutex_unlock(&audio->mutex);
+        audio_hurt(audio);
     }
 
     bool did_shoot = 0;
@@ -135,12 +173,7 @@ static void player_update(Player *player, Collision_World *world, Engine *eng, A
         player->screen_shake += .5;
         did_shoot = 1;
 
-        mutex_lock(&audio->mutex);
-        audio->shoot[audio->shoot_ix].active = true;
-        audio->shoot[audio->shoot_ix].pos = 0;
-        audio->shoot[audio->shoot_ix].freq = sound_scale(rand_u32(G->rand, 3 * 7, 4 * 7));
-        audio->shoot_ix = (audio->shoot_ix + 1) % array_count(audio->shoot);
-        mutex_unlock(&audio->mutex);
+        audio_effect_local(audio, sound_scale(rand_u32(G->rand, 3 * 7, 4 * 7)));
     }
 
     if (player->screen_shake > .5) player->screen_shake = .5;
@@ -185,37 +218,32 @@ static void player_update(Player *player, Collision_World *world, Engine *eng, A
     player->camera = mtx_camera;
     player->inv_camera = m4_invert_tr(player->camera);
 
-    mutex_lock(&audio->mutex);
+    // Listener position for spatial sound effects
     audio->inv_mtx = player->inv_camera;
-    mutex_unlock(&audio->mutex);
 
     if (did_shoot) {
+        // A multiple of 8, the shots are traced in packets
         u32 n = 32 * 4;
+        Player_Shot *shots = mem_array_zero(G->tmp, Player_Shot, n);
         for (u32 i = 0; i < n; ++i) {
-            Collide_Result hit_res = {.distance = 1000.0f};
-            Collision_Object *hit_obj = 0;
-
             f32 shot_ang = rand_f32(&eng->rng, 0, 1);
             f32 shot_dist = rand_f32(&eng->rng, 0, .06f);
             m4 shoot_mtx = mtx_head;
-            v3 shoot_pos = shoot_mtx.w;
-            v3 shoot_dir = shoot_mtx.z;
-            shoot_dir += shoot_mtx.x * f_cos2pi(shot_ang) * shot_dist;
-            shoot_dir += shoot_mtx.y * f_sin2pi(shot_ang) * shot_dist;
-            for (Collision_Object *obj = world->objects; obj; obj = obj->next) {
-                Collide_Result res;
-                if (collide_quad_ray(&res, obj->mtx, shoot_pos, shoot_dir)) {
-                    Image *img = obj->img;
-                    v4 *px = image_get(img, (v2i){(res.uv.x + .5) * img->size.x, (.5 - res.uv.y) * img->size.y});
-
-                    if (!px) continue;
-                    if (px->w < .9f) continue;
-                    if (res.distance > hit_res.distance) continue;
-                    hit_obj = obj;
-                    hit_res = res;
-                }
-            }
+            shots[i].pos = shoot_mtx.w;
+            shots[i].dir = shoot_mtx.z;
+            shots[i].dir += shoot_mtx.x * f_cos2pi(shot_ang) * shot_dist;
+            shots[i].dir += shoot_mtx.y * f_sin2pi(shot_ang) * shot_dist;
+        }
 
+        // Trace all rays in parallel, then apply the hits in order
+        Player_Shoot_Job job = {world, shots};
+        Job_Group group = {};
+        job_for(&group, n / 8, 1, player_shoot_trace, &job);
+        job_wait(&group);
+
+        for (u32 i = 0; i < n; ++i) {
+            Collision_Object *hit_obj = shots[i].hit_obj;
+            Collide_Result hit_res = shots[i].hit_res;
             if (hit_obj) {
                 Image *img = hit_obj->img;
                 v4 *px = image_get(img, (v2i){(hit_res.uv.x + .5) * img->size.x, (.5 - hit_res.uv.y) * img->size.y});
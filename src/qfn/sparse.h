@@ -1,10 +1,18 @@
 // Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
-// sparse.h - Incremental BVH
+// sparse.h - Spatial hash of boxes
 #pragma once
 #include "gfx/box.h"
 #include "lib/mem.h"
-
-// Immediate Bounding Volume Hirachy
+#include "lib/pool.h"
+
+// Boxes sorted into cells in the xz plane, for finding overlapping boxes.
+// - Every node is stored in the cell that contains its center.
+// - Cells are only created when a node is added, and are found with a hash table.
+// - A query only visits the cells whose nodes could reach the query box.
+//   Nodes stick out of their cell by at most the largest node radius, so the query is grown by that radius.
+//   If the query covers more cells than there are, all cells are visited instead,
+//   so a query never costs more than a full scan.
+// - The hash table doubles when there are more cells than buckets.
 typedef struct Sparse Sparse;
 typedef struct Sparse_Node Sparse_Node;
 typedef struct Sparse_Cell Sparse_Cell;
@@ -22,7 +30,6 @@ struct Sparse_Node {
     Sparse_Node *next;
 };
 
-// A collection of nodes that are nearest to this cell position
 // A cell that contains all nodes with the center in this cell.
 #define SPARSE_CELL_SIZE 4
 struct Sparse_Cell {
@@ -36,59 +43,104 @@ struct Sparse_Cell {
 
     // Nodes in this Cell
     Sparse_Node *nodes;
+
+    // Next cell in the same bucket
     Sparse_Cell *next;
 };
 
+// Initial number of buckets, a power of two
+#define SPARSE_BUCKETS_MIN 64
+
 struct Sparse {
     Memory *mem;
 
-    // Cell Hash Map indexed by position
-    Sparse_Cell *cells[32 * 32];
+    // Nodes are stored contiguously, instead of between the cells and collisions
+    Pool node_pool;
+
+    // Cell hash map indexed by position, 'bucket_count' is a power of two
+    u32 bucket_count;
+    Sparse_Cell **buckets;
+    u32 cell_count;
+
+    // Largest radius of all nodes
+    v3 radius;
 };
 
-static u32 _sparse_hash(v3i pos) {
-    return (pos.x % 32) + (pos.z % 32) * 32;
+// Cell that contains a position, cells are centered on multiples of SPARSE_CELL_SIZE
+static v3i sparse_cell_pos(v3 pos) {
+    return (v3i){f_floor(pos.x / SPARSE_CELL_SIZE + 0.5f), 0, f_floor(pos.z / SPARSE_CELL_SIZE + 0.5f)};
+}
+
+// Mix both coordinates, so negative and far away cells are spread over all buckets
+static u32 sparse_hash(v3i pos) {
+    u32 hash = (u32)pos.x * 0x9e3779b1 ^ (u32)pos.z * 0x85ebca77;
+    return hash ^ (hash >> 16);
 }
 
 static Sparse *sparse_new(Memory *mem) {
     Sparse *sparse = mem_struct(mem, Sparse);
     sparse->mem = mem;
+    sparse->node_pool = pool_for(mem, Sparse_Node);
+    sparse->bucket_count = SPARSE_BUCKETS_MIN;
+    sparse->buckets = mem_array_zero(mem, Sparse_Cell *, sparse->bucket_count);
     return sparse;
 }
 
+static Sparse_Cell *sparse_find(Sparse *sparse, v3i pos) {
+    Sparse_Cell *cell = sparse->buckets[sparse_hash(pos) & (sparse->bucket_count - 1)];
+    while (cell && !v3i_eq(cell->pos, pos)) cell = cell->next;
+    return cell;
+}
+
+// Double the number of buckets, the old table stays in memory until the sparse memory is freed
+static void sparse_grow(Sparse *sparse) {
+    u32 bucket_count = sparse->bucket_count * 2;
+    Sparse_Cell **buckets = mem_array_zero(sparse->mem, Sparse_Cell *, bucket_count);
+    for (u32 i = 0; i < sparse->bucket_count; ++i) {
+        Sparse_Cell *cell = sparse->buckets[i];
+        while (cell) {
+            Sparse_Cell *next = cell->next;
+            Sparse_Cell **bucket = buckets + (sparse_hash(cell->pos) & (bucket_count - 1));
+            cell->next = *bucket;
+            *bucket = cell;
+            cell = next;
+        }
+    }
+    sparse->bucket_count = bucket_count;
+    sparse->buckets = buckets;
+}
+
 // Insert a box with user-data into the sparse graph
 static void sparse_add(Sparse *sparse, Box box, void *user) {
-    v3i pos = v3_to_v3i(box_center(box) * 1.0f / SPARSE_CELL_SIZE + (v3){0.5, 0.0, 0.5});
-    pos.y = 0;
-
-    Sparse_Cell **cell_list = sparse->cells + _sparse_hash(pos);
+    v3i pos = sparse_cell_pos(box_center(box));
 
     // Find Cell at pos
-    Sparse_Cell *cell = *cell_list;
-    for (;;) {
-        if (!cell) break;
-        if (v3i_eq(cell->pos, pos)) break;
-        cell = cell->next;
-    }
+    Sparse_Cell *cell = sparse_find(sparse, pos);
 
     if (!cell) {
         // No cell found, create a new one
+        if (sparse->cell_count == sparse->bucket_count) sparse_grow(sparse);
+        Sparse_Cell **bucket = sparse->buckets + (sparse_hash(pos) & (sparse->bucket_count - 1));
         cell = mem_struct(sparse->mem, Sparse_Cell);
         cell->pos = pos;
         cell->box = box;
-        cell->next = *cell_list;
-        *cell_list = cell;
+        cell->next = *bucket;
+        *bucket = cell;
+        sparse->cell_count++;
     } else {
         // Cell exists, grow box
         cell->box = box_union(cell->box, box);
     }
 
     // Add node to cell
-    Sparse_Node *node = mem_struct(sparse->mem, Sparse_Node);
+    Sparse_Node *node = pool_struct(&sparse->node_pool, Sparse_Node);
     node->box = box;
     node->user = user;
     node->next = cell->nodes;
     cell->nodes = node;
+
+    v3 radius = box_radius(box);
+    sparse->radius = (v3){f_max(sparse->radius.x, radius.x), f_max(sparse->radius.y, radius.y), f_max(sparse->radius.z, radius.z)};
 }
 
 // A list of nodes that collide with some other node
@@ -100,19 +152,39 @@ struct Sparse_Collision {
     Sparse_Collision *next;
 };
 
+// Add all nodes in a cell that intersect 'box' to 'list'
+static void sparse_check_cell(Sparse *sparse, Sparse_Cell *cell, Box box, Sparse_Collision **list) {
+    if (!box_intersect(cell->box, box)) return;
+    for (Sparse_Node *node = cell->nodes; node; node = node->next) {
+        if (!box_intersect(node->box, box)) continue;
+        Sparse_Collision *col = mem_struct(sparse->mem, Sparse_Collision);
+        col->next = *list;
+        col->node = node;
+        *list = col;
+    }
+}
+
 // Intersect box with all boxes in the sparse graph
-// Returrns a list of collisions allocated in the sparse memory
+// Returns a list of collisions allocated in the sparse memory
 static Sparse_Collision *sparse_check(Sparse *sparse, Box box) {
     Sparse_Collision *col_list = 0;
-    for (u32 i = 0; i < array_count(sparse->cells); ++i) {
-        for (Sparse_Cell *cell = sparse->cells[i]; cell; cell = cell->next) {
-            if (!box_intersect(cell->box, box)) continue;
-            for (Sparse_Node *node = cell->nodes; node; node = node->next) {
-                if (!box_intersect(node->box, box)) continue;
-                Sparse_Collision *col = mem_struct(sparse->mem, Sparse_Collision);
-                col->next = col_list;
-                col->node = node;
-                col_list = col;
+
+    // Cells that can contain the center of an intersecting node
+    v3i min = sparse_cell_pos(box.min - sparse->radius);
+    v3i max = sparse_cell_pos(box.max + sparse->radius);
+    i64 range = ((i64)max.x - min.x + 1) * ((i64)max.z - min.z + 1);
+
+    if (range > sparse->cell_count) {
+        for (u32 i = 0; i < sparse->bucket_count; ++i) {
+            for (Sparse_Cell *cell = sparse->buckets[i]; cell; cell = cell->next) {
+                sparse_check_cell(sparse, cell, box, &col_list);
+            }
+        }
+    } else {
+        for (i32 z = min.z; z <= max.z; ++z) {
+            for (i32 x = min.x; x <= max.x; ++x) {
+                Sparse_Cell *cell = sparse_find(sparse, (v3i){x, 0, z});
+                if (cell) sparse_check_cell(sparse, cell, box, &col_list);
             }
         }
     }
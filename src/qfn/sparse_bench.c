@@ -0,0 +1,77 @@
+// Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
+// sparse_bench.c - Compare Sparse_Set queries against the linear world_collide
+//
+// Run with: ./build build src/qfn/sparse_bench.c out/sparse_bench --release && out/sparse_bench
+#include "lib/fmt.h"
+#include "lib/os_main.h"
+#include "lib/rand.h"
+#include "qfn/sparse_set.h"
+#include "qfn/world.h"
+
+// Every object queries its own box, like monsters looking for their neighbours
+// 40x40 maze cells of 2 units, centered on the origin
+#define BENCH_LEVEL_SIZE 80.0f
+#define BENCH_FRAMES 8
+
+static Box bench_box(Rand *rng) {
+    v3 pos = {rand_f32(rng, -0.5f, 0.5f), 0, rand_f32(rng, -0.5f, 0.5f)};
+    pos *= BENCH_LEVEL_SIZE;
+    v3 radius = {0.5f, 1.0f, 0.5f};
+    return (Box){pos - radius, pos + radius};
+}
+
+// Run all queries of a few frames, returns the time per frame in us and the total number of hits
+static f32 bench_run(bool sparse, u32 count, u32 *hits) {
+    Rand rng = rand_new(1);
+    Memory *mem = mem_new();
+    Box *boxes = mem_array_uninit(mem, Box, count);
+    for (u32 i = 0; i < count; ++i) boxes[i] = bench_box(&rng);
+
+    World *world = mem_struct(mem, World);
+    Sparse_Set *set = sparse_set_new(mem);
+
+    u64 time = 0;
+    *hits = 0;
+    for (u32 frame = 0; frame < BENCH_FRAMES + 1; ++frame) {
+        Memory *tmp = mem_new();
+        u64 t0 = os_time();
+        world_begin(world);
+        sparse_set_swap(set);
+        for (u32 i = 0; i < count; ++i) {
+            if (sparse) {
+                sparse_set_add(set, boxes[i], boxes + i);
+                for (Sparse_Collision *col = sparse_set_check(set, boxes[i]); col; col = col->next) (*hits)++;
+            } else {
+                world_add(world, Entity_Monster, boxes[i], boxes + i);
+                for (World_Object *obj = world_collide(world, tmp, boxes[i]); obj; obj = obj->next) (*hits)++;
+            }
+        }
+        u64 t1 = os_time();
+        mem_free(tmp);
+
+        // The first frame only fills the previous frame
+        if (frame > 0) time += t1 - t0;
+    }
+    mem_free(mem);
+    return (f32)time / BENCH_FRAMES;
+}
+
+static void os_main(void) {
+    u32 counts[] = {100, 300, 1000, 3000, 10000};
+
+    fmt_s(G->fmt, "Time per frame in us, world_collide -> sparse_set_check\n");
+    for (u32 i = 0; i < array_count(counts); ++i) {
+        u32 linear_hits, sparse_hits;
+        f32 linear = bench_run(false, counts[i], &linear_hits);
+        f32 sparse = bench_run(true, counts[i], &sparse_hits);
+        fmt_su(G->fmt, "  ", counts[i], " objects: ");
+        fmt_f(G->fmt, linear);
+        fmt_s(G->fmt, " -> ");
+        fmt_f(G->fmt, sparse);
+        fmt_sf(G->fmt, " (", linear / sparse, "x)");
+        if (linear_hits != sparse_hits) fmt_s(G->fmt, " MISMATCH");
+        fmt_s(G->fmt, "\n");
+    }
+    fmt_flush(G->fmt);
+    os_exit(0);
+}
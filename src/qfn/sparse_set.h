@@ -1,24 +1,42 @@
 // Copyright (c) 2025 - Tom Smeets <tom@tsmeets.nl>
-// sparse_set.h - Incremental BVH
+// sparse_set.h - Double buffered spatial hash
 #pragma once
 #include "qfn/sparse.h"
 
+// Objects are added to 'new' while queries read 'old', the state of the previous frame.
+// So every object can add itself and query the others in the same update,
+// without depending on the update order.
+// Both have their own memory, which is rewound to the start when it is reused.
 typedef struct {
     Sparse *new;
     Sparse *old;
+
+    // Start of the memory of 'new' and 'old'
+    Memory_Mark new_mark;
+    Memory_Mark old_mark;
 } Sparse_Set;
 
 static Sparse_Set *sparse_set_new(Memory *mem) {
     Sparse_Set *set = mem_struct(mem, Sparse_Set);
-    set->new = sparse_new(mem_new());
-    set->old = sparse_new(mem_new());
+    Memory *new_mem = mem_new();
+    Memory *old_mem = mem_new();
+    set->new_mark = mem_mark(new_mem);
+    set->old_mark = mem_mark(old_mem);
+    set->new = sparse_new(new_mem);
+    set->old = sparse_new(old_mem);
     return set;
 }
 
+// Call this at the start of every frame
 static void sparse_set_swap(Sparse_Set *set) {
-    mem_free(set->old->mem);
+    Memory *mem = set->old->mem;
+    Memory_Mark mark = set->old_mark;
+    mem_rewind(mem, mark);
+
     set->old = set->new;
-    set->new = sparse_new(mem_new());
+    set->old_mark = set->new_mark;
+    set->new = sparse_new(mem);
+    set->new_mark = mark;
 }
 
 static void sparse_set_add(Sparse_Set *sparse, Box box, void *user) {
@@ -0,0 +1,44 @@
+#pragma once
+#include "lib/rand.h"
+#include "lib/test.h"
+#include "qfn/sparse.h"
+
+// Compare queries against a linear scan, with negative and far away positions and a few big boxes
+static void sparse_test(Test *test) {
+    Rand rng = rand_new(1);
+    Sparse *sparse = sparse_new(test->mem);
+
+    u32 count = 1000;
+    Box *boxes = mem_array_uninit(test->mem, Box, count);
+    for (u32 i = 0; i < count; ++i) {
+        v3 pos = {rand_f32(&rng, -300, 300), rand_f32(&rng, -2, 2), rand_f32(&rng, -300, 300)};
+        v3 radius = {rand_f32(&rng, 0.1, 1), rand_f32(&rng, 0.1, 1), rand_f32(&rng, 0.1, 1)};
+        if (i % 100 == 0) radius *= 20;
+        boxes[i] = (Box){pos - radius, pos + radius};
+        sparse_add(sparse, boxes[i], boxes + i);
+    }
+    TEST(sparse->bucket_count >= sparse->cell_count);
+    TEST(sparse->bucket_count > SPARSE_BUCKETS_MIN);
+
+    bool found_ok = true;
+    u32 hit_count = 0;
+    for (u32 i = 0; i < 500; ++i) {
+        v3 pos = {rand_f32(&rng, -300, 300), rand_f32(&rng, -2, 2), rand_f32(&rng, -300, 300)};
+        v3 radius = {rand_f32(&rng, 0.1, 8), 1, rand_f32(&rng, 0.1, 8)};
+        if (i % 50 == 0) radius *= 100;
+        Box query = {pos - radius, pos + radius};
+
+        u32 expected = 0;
+        for (u32 j = 0; j < count; ++j) expected += box_intersect(boxes[j], query);
+
+        u32 found = 0;
+        for (Sparse_Collision *col = sparse_check(sparse, query); col; col = col->next) {
+            found_ok &= box_intersect(*(Box *)col->node->user, query);
+            found++;
+        }
+        found_ok &= found == expected;
+        hit_count += found;
+    }
+    TEST(found_ok);
+    TEST(hit_count > 0);
+}
@@ -0,0 +1,15 @@
+#include "lib/os_main.h"
+#include "lib/test.h"
+#include "qfn/collision_test.h"
+#include "qfn/maze_test.h"
+#include "qfn/sparse_test.h"
+
+static void os_main(void) {
+    Test *test = test_begin();
+
+    sparse_test(test);
+    collision_wide_test(test);
+    collision_ray8_world_test(test);
+    maze_line_test(test);
+    test_end(test);
+}
@@ -26,9 +26,21 @@ static Wall *wall_new(Memory *mem, m4 mtx, Image *image) {
     return wall;
 }
 
-static void wall_update(Wall *wall, Engine *eng, Collision_World *world) {
+static void wall_update(Wall *wall, Engine *eng) {
     gfx_draw_3d(eng->gfx, wall->mtx, wall->image);
-    collision_add(world, wall->mtx, wall->image, 0, wall);
+}
+
+// Walls never move, so their collision objects are created once
+static Collision_Bvh *wall_bvh_new(Memory *mem, Wall *walls) {
+    u32 count = 0;
+    for (Wall *wall = walls; wall; wall = wall->next) count++;
+
+    Collision_Object *objects = mem_array_zero(mem, Collision_Object, count);
+    Collision_Object *obj = objects;
+    for (Wall *wall = walls; wall; wall = wall->next) {
+        collision_object_init(obj++, wall->mtx, wall->image, 0, wall);
+    }
+    return collision_bvh_new(mem, count, objects);
 }
 
 static v3 wall_collide(m4 mtx, f32 r, v3 old, v3 new) {
@@ -2,6 +2,7 @@
 #include "gfx/box.h"
 #include "gfx/image.h"
 #include "lib/mat.h"
+#include "lib/pool.h"
 
 typedef enum {
     Entity_Player,
@@ -32,26 +33,35 @@ static World_Object *world_cast(World *world, v3 pos, v3 dir);
 static World_Object *world_collide(World *world, Memory *mem, Box box);
 
 struct World {
-    Memory *mem_next;
-    Memory *mem_prev;
+    // Objects of this frame and the previous frame.
+    // The pools are swapped every frame and keep their memory.
+    Memory *mem;
+    Pool pool_next;
+    Pool pool_prev;
     World_Object *obj_next;
     World_Object *obj_prev;
 };
 
 static void world_begin(World *world) {
-    // Free(prev)
-    if (world->mem_prev) mem_free(world->mem_prev);
+    // A World starts zero initialized, create the pools on first use
+    if (!world->mem) {
+        world->mem = mem_new();
+        world->pool_next = pool_for(world->mem, World_Object);
+        world->pool_prev = pool_for(world->mem, World_Object);
+    }
 
-    // Next -> Prev
-    world->mem_prev = world->mem_next;
-    world->obj_prev = world->obj_next;
+    // Next -> Prev, and reuse the old prev for next
+    Pool pool = world->pool_prev;
+    world->pool_prev = world->pool_next;
+    world->pool_next = pool;
+    pool_clear(&world->pool_next);
 
-    // next = new memory
-    world->mem_next = mem_new();
+    world->obj_prev = world->obj_next;
+    world->obj_next = 0;
 }
 
 static void world_add(World *world, Entity_Type type, Box box, void *entity) {
-    World_Object *obj = mem_struct(world->mem_next, World_Object);
+    World_Object *obj = pool_struct(&world->pool_next, World_Object);
     obj->type = type;
     obj->box = box;
     obj->entity = entity;